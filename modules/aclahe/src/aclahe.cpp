@@ -24,7 +24,10 @@
 
 /// OpenCV libraries. May need review for the final release
 #include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#ifndef HEADLESS
 #include <opencv2/highgui.hpp>
+#endif
 #include <opencv2/imgproc.hpp>
 
 //#cmakedefine FOUND_CUDA
@@ -41,6 +44,7 @@
 /// Include auxiliary utility libraries
 // TODO: change directory structure to math proposed template  (see mosaic repo)
 #include "../../common/preprocessing.h"
+#include "../../common/headless.h"
 
 #define ABOUT_STRING "ACLAHE C++ module v0.2"
 
@@ -50,13 +54,6 @@ using namespace cv;
 //using namespace cv::cuda;
 using namespace std;
 
-
-/*!
-	@fn		aclaheEntropy(cv::Mat img)
-	@brief	Computes the entropy of a single channel image, usually the luminance channel
-*/
-float aclaheEntropy(cv::Mat img);
-
 /*!
 	@fn		int main(int argc, char* argv[])
 	@brief	Main function
@@ -71,6 +68,8 @@ int main(int argc, char *argv[]) {
     String keys =
             "{@input |<none>  | Input video path}"    // input image is the first argument (positional)
                     "{@output |<none> | Prefix for output file}" // output prefix is the second argument (positional)
+                    "{headless |      | Do not show the source and resulting windows}"     // unattended run
+                    "{status  |       | Write the progress to this file, as a JSON object}"
                     "{help h usage ?  |       | show this help message}";      // optional, show help optional
 
     CommandLineParser cvParser(argc, argv, keys);
@@ -99,6 +98,13 @@ int main(int argc, char *argv[]) {
             1);    //String containing the output file template from cvParser function
     ostringstream OutputFileName;                        // output string that will contain the desired output file name
 
+#ifdef HEADLESS
+    bool headless = true;                               // built without HighGUI
+#else
+    bool headless = cvParser.has("headless");           // gets argument -headless, no windows are shown
+#endif
+    StatusFile status(cvParser.has("status") ? cvParser.get<cv::String>("status") : "", "aclahe");
+
     // Check if occurred any error during parsing process
     if (!cvParser.check()) {
         cvParser.printErrors();
@@ -133,16 +139,27 @@ int main(int argc, char *argv[]) {
     const char *src_window = "Source image";
     const char *dst_window = "Destination image";
 
+    // SIGINT/SIGTERM stop the search of the CL/BS pair
+    installStopHandler();
+    status.set("input", InputFile);
+    status.set("output", OutputFile);
+
     src = imread(InputFile, CV_LOAD_IMAGE_COLOR);
-/*    if (src == NULL){
+    if (src.empty()){
         cout << "Failed to read input image, exiting..." << endl;
+        status.update("failed", true);
         return -1;
-    }*/
+    }
 
     cout << "Input image loaded..." << endl;
-    namedWindow(src_window, WINDOW_AUTOSIZE);
-    namedWindow(dst_window, WINDOW_AUTOSIZE);
-    imshow(src_window, src);
+#ifndef HEADLESS
+    if (!headless) {
+        namedWindow(src_window, WINDOW_AUTOSIZE);
+        namedWindow(dst_window, WINDOW_AUTOSIZE);
+        imshow(src_window, src);
+    }
+#endif
+    status.update("running", true);
 
     //**************************************************************************
     //Convert image into grayscale
@@ -153,7 +170,9 @@ int main(int argc, char *argv[]) {
     // Split image into 3 different channels. Split[2] will be V channel
     split(dst, channels);
 
-    imshow(dst_window, channels[1]);
+#ifndef HEADLESS
+    if (!headless) imshow(dst_window, channels[1]);
+#endif
 
     //**************************************************************************
     //Create base vector of BlockSize and ClipLimit values
@@ -177,8 +196,10 @@ int main(int argc, char *argv[]) {
 
     float entropy;
 
-    for (int i = 0; i < 5; i++) {
-        for (float cl = minContrastLimit; cl <= maxContrastLimit; cl += stepContrastLimit) {
+    for (int i = 0; i < 5 && !stopRequested(); i++) {
+        status.set("block_size", BlockSize[i]);
+        status.update("running");
+        for (float cl = minContrastLimit; cl <= maxContrastLimit && !stopRequested(); cl += stepContrastLimit) {
             // set up ClipLimit (ContrastLimit) and TileSize(BlockSize)
             cv::Size bs(BlockSize[i],BlockSize[i]);
             clahe->setClipLimit(cl);
@@ -196,7 +217,7 @@ int main(int argc, char *argv[]) {
     // while varying CL along all its range
     // CAUTION: OpenCV CL range differs to Matlab implementation
 
-    for (int i=0; i<5; i++){
+    for (size_t i=0; i<entropyResults.size(); i++){
         row = entropyResults[i];
         for (int j=0; j<row.size(); j++){
             double s = row[j];
@@ -217,32 +238,9 @@ int main(int argc, char *argv[]) {
     //**************************************************************************
     //saves resulting image
     //**************************************************************************
-    waitKey(0);
+    status.update(stopRequested() ? "stopped" : "done", true);
+#ifndef HEADLESS
+    if (!headless) waitKey(0);
+#endif
     return 0;
 }
-
-/*!
-	@fn		aclaheEntropy(cv::Mat img)
-	@brief	Computes the entropy of a single channel image, usually the luminance channel
-*/
-float aclaheEntropy(cv::Mat img){
-    float entropy = 0;
-    cv::Mat hist;      // 256-bin histogram (pixel count)
-    float histN[256];   // normalized histogram
-
-    int width, height;
-    width = img.size().width;
-    height = img.size().height;
-
-    // Finds the image histogram
-    getHistogram(&img, &hist);
-    // Normalize the histogram, by the total number of pixels, and also convert it into log2
-    // Computes the entropy as the Shannon Index
-    for (int i=0; i< 256; i++){
-        histN[i] = hist.at<float>(i,0) / (width * height);
-        // we add 0.0000001 just in case there is a NULL bin in the histogram
-        entropy = entropy + ( histN[i] * log2(histN[i] + 0.00001));
-        // real entropy value is negative of this result
-    }
-    return (-entropy);
-}
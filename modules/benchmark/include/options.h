@@ -0,0 +1,30 @@
+/**
+ * @file options.h
+ * @brief Argument parser options of the benchmark, based on args.hxx
+ * @version 1.0
+ * @date 17/10/2026
+ */
+
+#ifndef _OPTIONS_H_
+#define _OPTIONS_H_
+
+#include <iostream>
+#include "../../common/args.hxx"
+
+args::ArgumentParser 	argParser("","");
+args::HelpFlag 	argHelp(argParser, "help", "Display this help menu", {'h', "help"});
+args::ValueFlag	<std::string> 	argKernel(argParser, "kernel", "Only run the kernels whose name contains <kernel>", {'k', "kernel"});
+args::ValueFlag	<double> 	argTime(argParser, "seconds", "Minimum measuring time per case, in seconds (default: 0.25)", {'t', "time"});
+args::Flag			argQuick(argParser, "quick", "Only benchmark the analysis resolution (640x480)", {"quick"});
+args::ValueFlag	<std::string> 	argFeatures(argParser, "features", "Feature type used by calcOverlap: SURF, ORB, AKAZE or BRISK (default: SURF if available)", {'d', "features"});
+args::ValueFlag	<std::string> 	argOutput(argParser, "file", "Write the results to <file> as CSV", {'o', "output"});
+args::ValueFlag	<std::string> 	argBaseline(argParser, "file", "Compare against the CSV of a previous run, and fail on regressions", {'c', "compare"});
+args::ValueFlag	<double> 	argTolerance(argParser, "percent", "Slowdown against the baseline reported as a regression (default: 10)", {"tolerance"});
+
+#endif
+
+const std::string green("\033[1;32m");
+const std::string yellow("\033[1;33m");
+const std::string cyan("\033[1;36m");
+const std::string red("\033[1;31m");
+const std::string reset("\033[0m");
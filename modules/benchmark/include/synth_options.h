@@ -0,0 +1,38 @@
+/**
+ * @file synth_options.h
+ * @brief Argument parser options of the synthetic video generator, based on args.hxx
+ * @version 1.0
+ * @date 17/10/2026
+ */
+
+#ifndef _SYNTH_OPTIONS_H_
+#define _SYNTH_OPTIONS_H_
+
+#include <iostream>
+#include "../../common/args.hxx"
+
+args::ArgumentParser 	argParser("","");
+args::HelpFlag 	argHelp(argParser, "help", "Display this help menu", {'h', "help"});
+args::ValueFlag	<std::string> 	argResolution(argParser, "WxH", "Resolution of the video (default: 1920x1080)", {'r', "resolution"});
+args::ValueFlag	<double> 	argFPS(argParser, "fps", "Frame rate of the video (default: 25)", {"fps"});
+args::ValueFlag	<int> 		argFrames(argParser, "frames", "Number of frames (default: 600)", {'n', "frames"});
+args::ValueFlag	<double> 	argSpeed(argParser, "speed", "Forward motion per frame, as a fraction of the frame width (default: 0.01)", {'v', "speed"});
+args::ValueFlag	<double> 	argSway(argParser, "sway", "Lateral sway, as a fraction of the frame height (default: 0.1)", {"sway"});
+args::ValueFlag	<double> 	argYaw(argParser, "radians", "Amplitude of the heading oscillation (default: 0.1)", {"yaw"});
+args::ValueFlag	<double> 	argAltitude(argParser, "altitude", "Altitude (zoom) variation, as a fraction of the nominal one (default: 0.1)", {"altitude"});
+args::ValueFlag	<double> 	argExposure(argParser, "exposure", "Exposure as a fraction of the frame interval, sets the motion blur (default: 0.5)", {'b', "exposure"});
+args::ValueFlag	<double> 	argTurbidity(argParser, "turbidity", "Fading towards the water colour, in [0, 1) (default: 0.3)", {'u', "turbidity"});
+args::ValueFlag	<double> 	argNoise(argParser, "sigma", "Sensor noise, in grey levels (default: 2)", {"noise"});
+args::ValueFlag	<int> 		argSnow(argParser, "particles", "Marine snow particles per frame (default: 20)", {"snow"});
+args::ValueFlag	<int> 		argSeed(argParser, "seed", "Seed of the seabed and of the degradations", {"seed"});
+args::ValueFlag	<std::string> 	argCodec(argParser, "fourcc", "Codec of the video (default: MJPG)", {'c', "codec"});
+args::ValueFlag	<std::string> 	argTrajectory(argParser, "file", "Trajectory file (default: <output>.trajectory.csv)", {'t', "trajectory"});
+args::Positional<std::string> 	argOutput(argParser, "output", "Output video file");
+
+#endif
+
+const std::string green("\033[1;32m");
+const std::string yellow("\033[1;33m");
+const std::string cyan("\033[1;36m");
+const std::string red("\033[1;31m");
+const std::string reset("\033[0m");
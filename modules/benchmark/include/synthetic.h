@@ -0,0 +1,91 @@
+/**
+ * @file synthetic.h
+ * @brief Synthetic underwater inputs: seabed textures, and video frames rendered along a known camera trajectory
+ * @version 1.0
+ * @date 17/10/2026
+ *
+ * Every generator is seeded, so the same parameters always produce the same images and trajectory. This makes
+ * benchmark runs comparable across machines, without shipping real dive footage.
+ */
+#ifndef _SYNTHETIC_H_
+#define _SYNTHETIC_H_
+
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+
+#define TEXTURE_SEED    0x5eabed    //< Default seed of the synthetic textures and trajectories
+
+/**
+ * @brief Synthetic grayscale image of a given texture
+ * @param name  "seabed" (octaves of smooth noise, with features at every scale), "noise" (uniform white noise,
+ *              the best case for detectors) or "flat" (low contrast, turbid water, with few features)
+ */
+cv::Mat makeTexture(const std::string &name, cv::Size size, uint64_t seed = TEXTURE_SEED);
+
+/// Colour version of a grayscale texture, with the blue-green cast of underwater images (red is absorbed first)
+cv::Mat tint(const cv::Mat &grey);
+
+/// Colour seabed: the "seabed" texture with scattered rocks, whose edges give strong corners at several scales
+cv::Mat makeSeabed(cv::Size size, uint64_t seed = TEXTURE_SEED);
+
+/// Camera trajectory and image degradations of a synthetic survey video
+struct SurveySettings {
+    cv::Size frameSize;     // resolution of the rendered frames
+    int nFrames;
+    double speed;           // forward motion, in pixels per frame at the nominal altitude
+    double sway;            // amplitude of the lateral sway, as a fraction of the frame height
+    double yaw;             // amplitude of the heading oscillation, in radians
+    double altitude;        // amplitude of the altitude (zoom) variation, as a fraction of the nominal one
+    double exposure;        // exposure time as a fraction of the frame interval (length of the motion blur)
+    double turbidity;       // attenuation of the scene towards the water colour, in [0, 1)
+    double noise;           // standard deviation of the sensor noise, in grey levels
+    int snow;               // marine snow particles per frame
+    uint64_t seed;
+
+    SurveySettings();
+};
+
+/**
+ * @brief Renders a survey over a synthetic seabed, frame by frame
+ *
+ * The camera flies along the seabed (a single transect) with lateral sway, heading and altitude oscillations.
+ * The pose of every frame is known exactly, as the homography mapping frame pixels to seabed pixels.
+ */
+class SurveyRenderer {
+public:
+    explicit SurveyRenderer(const SurveySettings &settings);
+
+    /// Homography from the pixels of a frame to the pixels of the seabed (3x3, CV_64F)
+    cv::Mat pose(int frame) const;
+
+    /// Renders a frame (CV_8UC3), with motion blur, turbidity, marine snow and sensor noise
+    cv::Mat render(int frame);
+
+    /// Size of the seabed texture covering the whole trajectory
+    cv::Size seabedSize() const { return seabed.size(); }
+
+private:
+    SurveySettings settings;
+    cv::Mat seabed;
+    double extent;          // side of the square holding any rotated and zoomed frame, in frame pixels
+    double sampling;        // seabed pixels per frame pixel (below 1 when the seabed was too large to store)
+    cv::RNG rng;
+};
+
+/**
+ * @brief Overlap between two frames of a known trajectory, as videostrip estimates it
+ * @param poseObject    Pose (frame to seabed homography) of the current frame
+ * @param poseScene     Pose of the keyframe
+ * @param frameSize     Size of the rendered frames. The overlap is computed at the analysis resolution
+ *                      (TARGET_WIDTH wide), as overlapArea() is called with the homography between resized frames
+ */
+float trueOverlap(const cv::Mat &poseObject, const cv::Mat &poseScene, cv::Size frameSize);
+
+/// Writes the poses of a trajectory as CSV: frame,width,height and the 9 elements of each homography
+bool writeTrajectory(const std::string &filename, const std::vector<cv::Mat> &poses, cv::Size frameSize);
+
+/// Reads a trajectory written by writeTrajectory(). Returns false if the file is missing or malformed
+bool readTrajectory(const std::string &filename, std::vector<cv::Mat> &poses, cv::Size &frameSize);
+
+#endif // _SYNTHETIC_H_
@@ -0,0 +1,30 @@
+/**
+ * @file throughput_options.h
+ * @brief Argument parser options of the end-to-end throughput harness, based on args.hxx
+ * @version 1.0
+ * @date 17/10/2026
+ */
+
+#ifndef _THROUGHPUT_OPTIONS_H_
+#define _THROUGHPUT_OPTIONS_H_
+
+#include <iostream>
+#include "../../common/args.hxx"
+
+args::ArgumentParser 	argParser("","");
+args::HelpFlag 	argHelp(argParser, "help", "Display this help menu", {'h', "help"});
+args::ValueFlag	<std::string> 	argVideostrip(argParser, "path", "videostrip executable (default: videostrip, searched in PATH)", {'x', "videostrip"});
+args::ValueFlag	<std::string> 	argPrefix(argParser, "prefix", "Output prefix of the videostrip run (default: throughput_)", {'o', "output"});
+args::ValueFlag	<double> 	argMinOverlap(argParser, "overlap", "True overlap between consecutive keyframes below which the chain is broken (default: 0.05)", {"min-overlap"});
+args::ValueFlag	<std::string> 	argCSV(argParser, "file", "Append the summary of the run to <file>, as a CSV row", {"csv"});
+args::Positional<std::string> 	argInput(argParser, "video", "Synthetic video, as written by uwsynth");
+args::Positional<std::string> 	argTrajectory(argParser, "trajectory", "Trajectory of the video, as written by uwsynth");
+args::PositionalList<std::string> 	argOptions(argParser, "options", "videostrip options, after '--' (e.g. -- -p 0.6 -d ORB)");
+
+#endif
+
+const std::string green("\033[1;32m");
+const std::string yellow("\033[1;33m");
+const std::string cyan("\033[1;36m");
+const std::string red("\033[1;31m");
+const std::string reset("\033[0m");
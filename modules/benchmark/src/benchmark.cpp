@@ -0,0 +1,496 @@
+/********************************************************************/
+/* Project: uwimageproc							*/
+/* Module: 	benchmark						*/
+/* File: 	benchmark.cpp                                           */
+/* Created:		17/10/2026                                          */
+/* Description
+	Micro-benchmarks of the core image kernels of the toolbox (blur, overlap, histogram, stretch
+	and entropy) over several resolutions and synthetic textures. Reports the time per call and
+	per pixel, and the allocations per call. Results can be saved as CSV and compared against a
+	previous run, so optimizations can be measured and regressions caught.
+*/
+/********************************************************************/
+
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <new>
+
+#include "../../videostrip/include/videostrip.hpp"
+#include "../../videostrip/include/segments.h"
+#include "../../common/preprocessing.h"
+#include "../include/synthetic.h"
+#include "../include/options.h"
+
+#define MIN_TIME            0.25    //< Default minimum measuring time per case, in seconds
+#define MIN_CALLS           5       //< Minimum number of measured calls per case
+#define N_HOMOGRAPHIES      64      //< Random homographies cycled through by the overlapArea cases
+#define DEFAULT_TOLERANCE   10.0    //< Default slowdown (in %) against the baseline reported as a regression
+#define OVERLAP_TOLERANCE   0.01    //< Largest overlap difference between overlapArea and its raster reference (pixel rounding)
+#define BLUR_TOLERANCE      1e-3    //< Largest relative difference between calcBlur and its reference (absolute below 1)
+#define EXIT_REGRESSION     2       //< Exit status when a case is slower than the baseline
+#define EXIT_DISAGREEMENT   3       //< Exit status when a kernel does not match its reference kernel
+
+//**************************************************************************
+/* ALLOCATION COUNTING */
+// Every C++ heap allocation (including those of OpenCV internals, e.g. AutoBuffer) goes through operator new. Mat
+// buffers are taken with fastMalloc by the default MatAllocator, so they are counted there, as a single allocation
+// of their payload
+static std::atomic<uint64_t> nAllocs(0), nBytes(0);
+
+void *operator new(size_t size) {
+    nAllocs.fetch_add(1, std::memory_order_relaxed);
+    nBytes.fetch_add(size, std::memory_order_relaxed);
+    void *p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+// Counts the Mat buffers, and leaves the allocation itself to the standard allocator. Its header (UMatData) comes
+// from operator new, and is taken back from the counters: a Mat is counted once, with the size of its payload
+class CountingAllocator : public MatAllocator {
+public:
+    UMatData *allocate(int dims, const int *sizes, int type, void *data, size_t *step, int flags, UMatUsageFlags usageFlags) const {
+        size_t bytes = CV_ELEM_SIZE(type);
+        for (int i = 0; i < dims; i++) bytes *= sizes[i];
+        UMatData *u = Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usageFlags);
+        // the allocation already counted for the header stands for the whole Mat
+        nBytes.fetch_add(bytes, std::memory_order_relaxed);
+        nBytes.fetch_sub(sizeof(UMatData), std::memory_order_relaxed);
+        return u;
+    }
+    bool allocate(UMatData *data, int accessFlags, UMatUsageFlags usageFlags) const {
+        return Mat::getStdAllocator()->allocate(data, accessFlags, usageFlags);
+    }
+    void deallocate(UMatData *data) const {
+        Mat::getStdAllocator()->deallocate(data);
+    }
+};
+
+//**************************************************************************
+/* REFERENCE KERNELS */
+// Former implementations, kept to measure the current ones against them, both in speed and in results (see the
+// agreement checks at the end of the run)
+
+// calcBlur() as three OpenCV passes: grayscale conversion, Laplacian and standard deviation
+static float calcBlurReference(const Mat &frame) {
+    Mat grey = frame, laplacian;
+    if (frame.channels() == 3) cvtColor(frame, grey, COLOR_BGR2GRAY);
+    Laplacian(grey, laplacian, CV_16S);
+    Scalar mean, stdev;
+    meanStdDev(laplacian, mean, stdev);
+    return stdev.val[0];
+}
+
+// overlapArea() rasterizing the warped frame into a mask, and counting its pixels
+static float overlapAreaRaster(const Mat &H, Size frameSize) {
+    vector<Point2f> points, final_points;
+    points.push_back(Point2f(0, 0));
+    points.push_back(Point2f(frameSize.width, 0));
+    points.push_back(Point2f(frameSize.width, frameSize.height));
+    points.push_back(Point2f(0, frameSize.height));
+    perspectiveTransform(points, final_points, H);
+
+    Point points_array[4] = {final_points[0], final_points[1], final_points[2], final_points[3]};
+    Mat mask(frameSize, CV_8UC1, Scalar(0));
+    fillConvexPoly(mask, points_array, 4, Scalar(255));
+
+    float area_img1 = frameSize.area();
+    float area_img2 = contourArea(final_points);
+    float area_currOverlap = countNonZero(mask);
+    return area_currOverlap / (area_img1 + area_img2 - area_currOverlap);
+}
+
+//**************************************************************************
+/* AGREEMENT CHECKS */
+
+// Largest difference between a kernel and its reference over a set of inputs
+struct AgreementCheck {
+    string kernel, reference;
+    string measure;             // how the error is measured, for the report
+    double error;               // largest error found
+    double tolerance;           // largest error accepted
+    int inputs;                 // inputs compared
+
+    AgreementCheck(const string &kernel, const string &reference, const string &measure, double tolerance) :
+        kernel(kernel), reference(reference), measure(measure), error(0), tolerance(tolerance), inputs(0) {}
+
+    void add(double e) {
+        error = std::max(error, e);
+        inputs++;
+    }
+    bool passed() const { return error <= tolerance; }
+};
+
+// prints every check, returns the number of failed ones
+static int reportChecks(const vector<AgreementCheck> &checks) {
+    if (checks.empty()) return 0;
+    int nFailed = 0;
+    cout << endl << left << setw(22) << "kernel" << setw(22) << "reference" << setw(16) << "error" << right
+         << setw(10) << "max" << setw(12) << "tolerance" << setw(8) << "inputs" << endl;
+    for (size_t i = 0; i < checks.size(); i++) {
+        const AgreementCheck &c = checks[i];
+        if (!c.passed()) nFailed++;
+        cout << left << setw(22) << c.kernel << setw(22) << c.reference << setw(16) << c.measure << right
+             << scientific << setprecision(2) << setw(10) << c.error << setw(12) << c.tolerance << fixed
+             << setw(8) << c.inputs << "   " << (c.passed() ? green + "ok" : red + "FAILED") << reset << endl;
+    }
+    return nFailed;
+}
+
+//**************************************************************************
+/* SYNTHETIC INPUTS */
+
+// Random homographies between consecutive frames: translation, rotation, zoom and a slight perspective
+static vector<Mat> makeHomographies(Size size, int n) {
+    RNG rng(TEXTURE_SEED);
+    vector<Mat> homographies;
+    for (int i = 0; i < n; i++) {
+        double angle = rng.uniform(-0.1, 0.1), scale = rng.uniform(0.9, 1.1);
+        double tx = rng.uniform(-0.4, 0.4) * size.width, ty = rng.uniform(-0.4, 0.4) * size.height;
+        double px = rng.uniform(-1e-4, 1e-4), py = rng.uniform(-1e-4, 1e-4);
+        Mat H = (Mat_<double>(3, 3) << scale * cos(angle), -scale * sin(angle), tx,
+                                       scale * sin(angle),  scale * cos(angle), ty,
+                                       px, py, 1);
+        homographies.push_back(H);
+    }
+    return homographies;
+}
+
+//**************************************************************************
+/* BENCHMARK RUNNER */
+
+struct BenchResult {
+    string kernel, texture;
+    Size size;
+    uint64_t calls;
+    double mean, p50, p99;      // ns per call
+    double nsPixel;             // mean ns per pixel of the input
+    double allocs, bytes;       // per call
+};
+
+static volatile float sink;     // results of the kernels, so they cannot be optimized away
+
+// key of a case in the baseline
+static string caseKey(const string &kernel, const string &texture, Size size) {
+    ostringstream key;
+    key << kernel << "," << texture << "," << size.width << "," << size.height;
+    return key.str();
+}
+
+/**
+ * @brief Calls a kernel repeatedly, for at least minTime seconds and MIN_CALLS calls, after one warm-up call
+ * @param pixels    Pixels processed per call, for the time per pixel
+ */
+static BenchResult runCase(const string &kernel, const string &texture, Size size, double pixels,
+                           const std::function<void()> &fn, double minTime) {
+    fn();       // first call: lazy initialization, caches, thread pools
+    Histogram latency;
+    uint64_t allocs0 = nAllocs.load(), bytes0 = nBytes.load();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now(), t0, t1;
+    uint64_t calls = 0;
+    do {
+        t0 = std::chrono::steady_clock::now();
+        fn();
+        t1 = std::chrono::steady_clock::now();
+        latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+        calls++;
+    } while (calls < MIN_CALLS || std::chrono::duration<double>(t1 - start).count() < minTime);
+
+    BenchResult r;
+    r.kernel = kernel;
+    r.texture = texture;
+    r.size = size;
+    r.calls = calls;
+    r.mean = (double) latency.total() / calls;
+    r.p50 = latency.percentile(50);
+    r.p99 = latency.percentile(99);
+    r.nsPixel = r.mean / pixels;
+    r.allocs = (double) (nAllocs.load() - allocs0) / calls;
+    r.bytes = (double) (nBytes.load() - bytes0) / calls;
+    return r;
+}
+
+static bool readBaseline(const string &filename, std::map<string, double> &baseline) {
+    ifstream file(filename.c_str());
+    if (!file) return false;
+    string line;
+    getline(file, line);        // header
+    while (getline(file, line)) {
+        // kernel,texture,width,height,calls,ns_call,...
+        vector<string> fields;
+        stringstream row(line);
+        string field;
+        while (getline(row, field, ',')) fields.push_back(field);
+        if (fields.size() < 6) continue;
+        baseline[fields[0] + "," + fields[1] + "," + fields[2] + "," + fields[3]] = atof(fields[5].c_str());
+    }
+    return true;
+}
+
+/*!
+	@fn		int main(int argc, char* argv[])
+	@brief	Main function
+*/
+int main(int argc, char *argv[]) {
+
+//*********************************************************************************
+/*	PARSER section */
+    argParser.Description("uwbench - micro-benchmarks of the core kernels of [uwimageproc]: time per call and per pixel, "
+                          "and allocations per call, over several resolutions and synthetic textures");
+    argParser.Epilog("Visit [https://github.com/mecatronicaUSB] for project information\n");
+    argParser.Prog(argv[0]);
+    argParser.helpParams.width = 120;
+
+    try{
+        argParser.ParseCLI(argc, argv);
+    }
+    catch (args::Help){    // if argument asking for help, show this message
+        cout << argParser;
+        return 1;
+    }
+    catch (const args::ParseError &e){  //if some error ocurr while parsing, show summary
+        std::cerr << e.what() << std::endl;
+        std::cerr << "Use -h, --help command to see usage" << std::endl;
+        return 1;
+    }
+
+    string filter = argKernel ? args::get(argKernel) : "";
+    double minTime = argTime ? args::get(argTime) : MIN_TIME;
+    double tolerance = argTolerance ? args::get(argTolerance) : DEFAULT_TOLERANCE;
+    string featureType = argFeatures ? args::get(argFeatures) : DEFAULT_FEATURES;
+    Ptr<FeatureBackend> features = FeatureBackend::create(featureType);
+    if (features.empty()) {
+        cerr << red << "Unknown or unavailable feature type: " << featureType << reset << endl;
+        cerr << "Available types: " << FeatureBackend::available() << endl;
+        return 1;
+    }
+
+    std::map<string, double> baseline;
+    if (argBaseline && !readBaseline(args::get(argBaseline), baseline)) {
+        cerr << red << "Unable to read baseline: " << args::get(argBaseline) << reset << endl;
+        return 1;
+    }
+
+    cout << cyan << "uwbench" << reset << endl;
+    cout << "\tOpenCV version:\t" << yellow << CV_VERSION << reset << endl;
+    cout << "\tGit commit:\t" << yellow << GIT_COMMIT << reset << endl;
+    cout << "\tThreads:\t" << getNumThreads() << endl;
+    cout << "\tFeatures:\t" << features->name() << endl;
+
+    // Mat buffers are counted from now on
+    static CountingAllocator countingAllocator;
+    Mat::setDefaultAllocator(&countingAllocator);
+
+    vector<Size> sizes;
+    sizes.push_back(Size(TARGET_WIDTH, TARGET_HEIGHT));     // analysis resolution of videostrip
+    if (!argQuick) {
+        sizes.push_back(Size(1280, 720));
+        sizes.push_back(Size(1920, 1080));
+        sizes.push_back(Size(3840, 2160));                  // still images processed by histretch and aclahe
+    }
+    const char *textures[] = {"seabed", "noise", "flat"};
+
+    vector<BenchResult> results;
+    vector<AgreementCheck> checks;
+    // a check runs when its kernel is selected by the filter
+    auto checked = [&](const string &kernel) { return filter.empty() || kernel.find(filter) != string::npos; };
+    // runs a case unless it is filtered out, and prints its row as soon as it is done
+    auto bench = [&](const string &kernel, const string &texture, Size size, const std::function<void()> &fn) {
+        if (!filter.empty() && kernel.find(filter) == string::npos) return;
+        BenchResult r = runCase(kernel, texture, size, size.area(), fn, minTime);
+        results.push_back(r);
+        ostringstream resolution;
+        resolution << size.width << "x" << size.height;
+        cout << left << setw(22) << r.kernel << setw(8) << r.texture << setw(11) << resolution.str() << right << fixed
+             << setprecision(0) << setw(12) << r.mean << setw(12) << r.p50 << setw(12) << r.p99
+             << setprecision(3) << setw(10) << r.nsPixel
+             << setprecision(1) << setw(9) << r.allocs << setw(11) << r.bytes / 1024.0;
+        std::map<string, double>::const_iterator ref = baseline.find(caseKey(r.kernel, r.texture, r.size));
+        if (ref != baseline.end() && ref->second > 0) {
+            double change = 100.0 * (r.mean / ref->second - 1.0);
+            cout << (change > tolerance ? red : change < -tolerance ? green : reset)
+                 << setw(9) << showpos << change << "%" << noshowpos << reset;
+        }
+        cout << endl;
+    };
+
+    cout << endl << left << setw(22) << "kernel" << setw(8) << "texture" << setw(11) << "size" << right
+         << setw(12) << "ns/call" << setw(12) << "p50" << setw(12) << "p99" << setw(10) << "ns/px"
+         << setw(9) << "allocs" << setw(11) << "KB/call" << (baseline.empty() ? "" : "   change") << endl;
+
+    // histretch -c=HSV as a single step, and as the one step per channel it used to run
+    vector<ChannelStep> hsvPlan = compileChannelPlan("HSV"), hsvSplit;
+    for (const char *c = "HSV"; *c; c++) hsvSplit.push_back(compileChannelPlan(string(1, *c))[0]);
+
+    // calcBlur on colour and grayscale frames against the three pass reference. Besides the benchmarked sizes, an odd
+    // size with a width that is not a multiple of the vector width exercises the scalar tail and the borders
+    AgreementCheck blurCheck("calcBlur", "calcBlur/3pass", "max rel. error", BLUR_TOLERANCE);
+    auto checkBlur = [&](const Mat &frame) {
+        double reference = calcBlurReference(frame);
+        blurCheck.add(std::fabs(calcBlur(frame) - reference) / std::max(reference, 1.0));
+    };
+
+    //**************************************************************************
+    /* PER PIXEL KERNELS */
+    for (size_t s = 0; s < sizes.size(); s++) {
+        for (int t = 0; t < 3; t++) {
+            Mat grey = makeTexture(textures[t], sizes[s]);
+            Mat bgr = tint(grey);
+            Mat hist, stretched = grey.clone(), stretchedBgr = bgr.clone();
+            ChannelHistograms histograms;
+            Mat planned = bgr.clone();
+
+            bench("calcBlur", textures[t], sizes[s], [&]() { sink = calcBlur(bgr); });
+            bench("calcBlur/luma", textures[t], sizes[s], [&]() { sink = calcBlur(grey); });
+            bench("calcBlur/3pass", textures[t], sizes[s], [&]() { sink = calcBlurReference(bgr); });
+            if (checked("calcBlur")) {
+                checkBlur(bgr);
+                checkBlur(grey);
+            }
+            bench("getHistogram", textures[t], sizes[s], [&]() { getHistogram(&grey, &hist); });
+            bench("getHistograms", textures[t], sizes[s], [&]() { getHistograms(grey, histograms); });
+            bench("getHistograms/3ch", textures[t], sizes[s], [&]() { getHistograms(bgr, histograms); });
+            // stretches the same buffer over and over: values saturate, but the work per call does not change
+            bench("imgChannelStretch", textures[t], sizes[s], [&]() { imgChannelStretch(grey, stretched, 1, 99); });
+            bench("imgChannelStretch/3ch", textures[t], sizes[s], [&]() { imgChannelStretch(bgr, stretchedBgr, 1, 99); });
+            bench("channelPlan/HSV", textures[t], sizes[s], [&]() { applyChannelPlan(planned, hsvPlan, 2, 98); });
+            bench("channelPlan/HSV/split", textures[t], sizes[s], [&]() { applyChannelPlan(planned, hsvSplit, 2, 98); });
+            bench("aclaheEntropy", textures[t], sizes[s], [&]() { sink = aclaheEntropy(grey); });
+        }
+    }
+
+    if (checked("calcBlur")) {
+        for (int t = 0; t < 3; t++) {
+            Mat grey = makeTexture(textures[t], Size(333, 217));
+            checkBlur(tint(grey));
+            checkBlur(grey);
+        }
+        checks.push_back(blurCheck);
+    }
+
+    //**************************************************************************
+    /* OVERLAP ESTIMATION */
+    // Always at the analysis resolution, as videostrip resizes every frame before estimating the overlap
+    Size frameSize(TARGET_WIDTH, TARGET_HEIGHT);
+    vector<Mat> homographies = makeHomographies(frameSize, N_HOMOGRAPHIES);
+    int h = 0;
+    bench("overlapArea", "-", frameSize, [&]() {
+        sink = overlapArea(homographies[h], frameSize);
+        h = (h + 1) % N_HOMOGRAPHIES;
+    });
+    bench("overlapArea/raster", "-", frameSize, [&]() {
+        sink = overlapAreaRaster(homographies[h], frameSize);
+        h = (h + 1) % N_HOMOGRAPHIES;
+    });
+    // the exact polygon clipping against the rasterized mask: they only differ by the pixels along the borders
+    if (checked("overlapArea")) {
+        AgreementCheck check("overlapArea", "overlapArea/raster", "max |diff|", OVERLAP_TOLERANCE);
+        for (int i = 0; i < N_HOMOGRAPHIES; i++)
+            check.add(std::fabs(overlapArea(homographies[i], frameSize) - overlapAreaRaster(homographies[i], frameSize)));
+        checks.push_back(check);
+    }
+
+    // the flat texture has too few features for a homography
+    for (int t = 0; t < 2; t++) {
+        Mat grey = makeTexture(textures[t], frameSize);
+        keyframe kframe;
+        kframe.res_img = tint(grey);
+        kframe.grey = grey;
+        features->detectAndCompute(kframe.grey, kframe.keypoints, kframe.descriptors);
+        kframe.new_img = false;
+
+        // next frame: the same scene, shifted by a tenth of the frame and slightly rotated
+        Mat shift = (Mat_<double>(3, 3) << 0.999, -0.035, 0.1 * frameSize.width, 0.035, 0.999, 0.05 * frameSize.height, 0, 0, 1);
+        Mat object;
+        warpPerspective(grey, object, shift, frameSize);
+        vector<KeyPoint> keypoints;
+        Mat descriptors;
+        features->detectAndCompute(object, keypoints, descriptors);
+
+        bench("calcOverlap", textures[t], frameSize, [&]() { sink = calcOverlap(&kframe, object, *features); });
+        bench("calcOverlap/matched", textures[t], frameSize, [&]() {
+            sink = calcOverlap(&kframe, keypoints, descriptors, *features);
+        });
+    }
+
+    //**************************************************************************
+    /* SEAM RECONCILIATION */
+    // The previous segment ends on a view of the seabed, and the next one starts with keyframes further along it. Each
+    // head keyframe is given with its shift from the last keyframe (in frame widths): 0.02 repeats it (overlap 0.96),
+    // 0.5 still overlaps it below minOverlap (0.33). Whether reconcileSegments drops each of them is known
+    if (checked("reconcileSegments")) {
+        AgreementCheck check("reconcileSegments", "known seams", "wrong keyframes", 0);
+        SegmentSettings settings;
+        settings.selection.featureType = featureType;
+        Mat seabed = makeTexture("seabed", Size(2 * frameSize.width, frameSize.height));
+        auto view = [&](double shift) { return seabed(Rect(cvRound(shift * frameSize.width), 0, frameSize.width, frameSize.height)).clone(); };
+        auto seam = [&](const vector<int> &indices, const vector<double> &shifts, const vector<bool> &dropped) {
+            vector<Segment> segments(2);
+            SegmentKeyframe k;
+            k.index = 100;
+            k.grey = view(0);
+            k.dropped = false;
+            segments[0].keyframes.push_back(k);
+            for (size_t j = 0; j < indices.size(); j++) {
+                k.index = indices[j];
+                k.grey = view(shifts[j]);
+                segments[1].keyframes.push_back(k);
+            }
+            reconcileSegments(segments, settings);
+            int nWrong = 0;
+            for (size_t j = 0; j < dropped.size(); j++)
+                if (segments[1].keyframes[j].dropped != dropped[j]) nWrong++;
+            check.add(nWrong);
+        };
+        seam({101, 130}, {0.02, 0.5}, {true, false});           // repeated view, the next keyframe keeps the chain
+        seam({101}, {0.02}, {true});                            // repeated view, alone in its segment
+        seam({101}, {0.5}, {false});                            // needed to keep the chain
+        seam({100, 101, 130}, {0, 0.02, 0.5}, {true, true, false});    // shared seam frame, then a repeated view
+        checks.push_back(check);
+    }
+
+    //**************************************************************************
+    /* REPORT */
+    Mat::setDefaultAllocator(NULL);
+    if (argOutput) {
+        ofstream file(args::get(argOutput).c_str());
+        file << "kernel,texture,width,height,calls,ns_call,ns_call_p50,ns_call_p99,ns_pixel,allocs_call,bytes_call" << endl;
+        for (size_t i = 0; i < results.size(); i++) {
+            const BenchResult &r = results[i];
+            file << r.kernel << "," << r.texture << "," << r.size.width << "," << r.size.height << "," << r.calls << ","
+                 << r.mean << "," << r.p50 << "," << r.p99 << "," << r.nsPixel << "," << r.allocs << "," << r.bytes << endl;
+        }
+        if (!file) {
+            cerr << red << "Unable to write results to: " << args::get(argOutput) << reset << endl;
+            return 1;
+        }
+        cout << endl << green << "Results written to: " << reset << args::get(argOutput) << endl;
+    }
+
+    // kernels that do not match their reference fail the run, whatever their speed
+    int nDisagreements = reportChecks(checks);
+    if (nDisagreements > 0)
+        cerr << endl << red << nDisagreements << " kernels do not match their reference" << reset << endl;
+    else if (!checks.empty())
+        cout << endl << green << "Every kernel matches its reference" << reset << endl;
+
+    if (!baseline.empty()) {
+        int nRegressions = 0;
+        for (size_t i = 0; i < results.size(); i++) {
+            std::map<string, double>::const_iterator ref = baseline.find(caseKey(results[i].kernel, results[i].texture, results[i].size));
+            if (ref != baseline.end() && results[i].mean > ref->second * (1.0 + tolerance / 100.0)) nRegressions++;
+        }
+        if (nRegressions > 0) {
+            cerr << endl << red << nRegressions << " cases are more than " << tolerance << "% slower than the baseline" << reset << endl;
+            return nDisagreements > 0 ? EXIT_DISAGREEMENT : EXIT_REGRESSION;
+        }
+        cout << endl << green << "No regressions against the baseline" << reset << endl;
+    }
+    return nDisagreements > 0 ? EXIT_DISAGREEMENT : 0;
+}
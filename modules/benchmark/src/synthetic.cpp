@@ -0,0 +1,187 @@
+/********************************************************************/
+/* Project: uwimageproc							*/
+/* Module: 	benchmark						*/
+/* File: 	synthetic.cpp                                           */
+/* Created:		17/10/2026                                          */
+/* Description
+	Synthetic underwater inputs for the benchmarks: seeded seabed textures, and survey videos
+	rendered along a known camera trajectory, with motion blur, turbidity, marine snow and noise.
+*/
+/********************************************************************/
+
+#include <cmath>
+
+#include "../include/synthetic.h"
+#include "../../videostrip/include/videostrip.hpp"
+
+#define SEABED_MAX_PIXELS   32e6    //< Largest seabed texture. Longer or larger surveys sample it more sparsely
+#define SWAY_PERIOD         300     //< Period of the lateral sway, in frames
+#define YAW_PERIOD          210     //< Period of the heading oscillation, in frames
+#define ALTITUDE_PERIOD     470     //< Period of the altitude variation, in frames
+
+Mat makeTexture(const string &name, Size size, uint64_t seed) {
+    RNG rng(seed);
+    Mat grey(size, CV_8UC1);
+    if (name == "noise")
+        rng.fill(grey, RNG::UNIFORM, 0, 256);
+    else if (name == "flat")
+        rng.fill(grey, RNG::NORMAL, 90, 3);
+    else {
+        // coarse to fine octaves of noise, upsampled so that each one is smooth at its own scale
+        Mat acc = Mat::zeros(size, CV_32F), octave, up;
+        for (int o = 0; o < 5; o++) {
+            int cell = 64 >> o;
+            octave.create(size.height / cell + 2, size.width / cell + 2, CV_32F);
+            rng.fill(octave, RNG::UNIFORM, -1, 1);
+            resize(octave, up, size, 0, 0, INTER_CUBIC);
+            acc += up / (o + 1);
+        }
+        normalize(acc, grey, 30, 200, NORM_MINMAX, CV_8U);
+    }
+    return grey;
+}
+
+Mat tint(const Mat &grey) {
+    Mat channels[3] = {grey.clone(), grey * 0.85, grey * 0.45};
+    Mat bgr;
+    merge(channels, 3, bgr);
+    return bgr;
+}
+
+Mat makeSeabed(Size size, uint64_t seed) {
+    Mat grey = makeTexture("seabed", size, seed);
+    // one rock every 150x150 pixels on average, with a dark shadow on one side and a lit face
+    RNG rng(seed + 1);
+    int nRocks = (int) (size.area() / (150.0 * 150.0));
+    for (int i = 0; i < nRocks; i++) {
+        Point centre(rng.uniform(0, size.width), rng.uniform(0, size.height));
+        Size axes(rng.uniform(4, 60), rng.uniform(4, 40));
+        double angle = rng.uniform(0.0, 180.0);
+        int shade = rng.uniform(-70, 70);
+        ellipse(grey, centre + Point(axes.width / 4, axes.height / 4), axes, angle, 0, 360, Scalar(20), -1);
+        ellipse(grey, centre, axes, angle, 0, 360, Scalar(std::min(std::max(130 + shade, 0), 255)), -1);
+    }
+    GaussianBlur(grey, grey, Size(3, 3), 0);
+    return tint(grey);
+}
+
+SurveySettings::SurveySettings() :
+    frameSize(1920, 1080),
+    nFrames(600),
+    speed(0.01),
+    sway(0.1),
+    yaw(0.1),
+    altitude(0.1),
+    exposure(0.5),
+    turbidity(0.3),
+    noise(2.0),
+    snow(20),
+    seed(TEXTURE_SEED) {
+}
+
+SurveyRenderer::SurveyRenderer(const SurveySettings &settings) :
+    settings(settings),
+    rng(settings.seed) {
+    // the seabed must hold the rotated and zoomed out frame at any point of the transect
+    const Size &fs = settings.frameSize;
+    extent = std::hypot((double) fs.width, (double) fs.height) * (1 + settings.altitude) + 16;
+    double length = settings.speed * fs.width * std::max(settings.nFrames - 1, 0) + extent;
+    double height = extent + 2 * settings.sway * fs.height;
+    sampling = std::min(1.0, std::sqrt(SEABED_MAX_PIXELS / (length * height)));
+    seabed = makeSeabed(Size(cvCeil(length * sampling), cvCeil(height * sampling)), settings.seed);
+}
+
+Mat SurveyRenderer::pose(int frame) const {
+    const Size &fs = settings.frameSize;
+    double x = extent / 2 + settings.speed * fs.width * frame;
+    double y = extent / 2 + settings.sway * fs.height * (1 + std::sin(2 * CV_PI * frame / SWAY_PERIOD));
+    double theta = settings.yaw * std::sin(2 * CV_PI * frame / YAW_PERIOD);
+    double s = 1 + settings.altitude * std::sin(2 * CV_PI * frame / ALTITUDE_PERIOD + 1);
+
+    // centre the frame, zoom (altitude), rotate (heading), and move it along the transect
+    Mat centre = (Mat_<double>(3, 3) << 1, 0, -fs.width / 2.0, 0, 1, -fs.height / 2.0, 0, 0, 1);
+    Mat motion = (Mat_<double>(3, 3) << s * std::cos(theta), -s * std::sin(theta), x,
+                                        s * std::sin(theta),  s * std::cos(theta), y,
+                                        0, 0, 1);
+    Mat toSeabed = (Mat_<double>(3, 3) << sampling, 0, 0, 0, sampling, 0, 0, 0, 1);
+    return toSeabed * motion * centre;
+}
+
+Mat SurveyRenderer::render(int frame) {
+    const Size &fs = settings.frameSize;
+    Mat H = pose(frame), img;
+    warpPerspective(seabed, img, H, fs, INTER_LINEAR | WARP_INVERSE_MAP, BORDER_REFLECT);
+
+    // motion blur along the direction of travel, as seen from the (rotated) camera. Its length varies from frame
+    // to frame, as with a shaking camera, so the blur-based keyframe refinement has something to choose from
+    double theta = settings.yaw * std::sin(2 * CV_PI * frame / YAW_PERIOD);
+    double s = 1 + settings.altitude * std::sin(2 * CV_PI * frame / ALTITUDE_PERIOD + 1);
+    double length = settings.speed * fs.width * settings.exposure / s * (1 + std::fabs(rng.gaussian(1.5)));
+    if (length >= 1.5) {
+        int ksize = 2 * cvCeil(length / 2) + 1;
+        Mat kernel = Mat::zeros(ksize, ksize, CV_32F);
+        Point2d dir(std::cos(-theta) * length / 2, std::sin(-theta) * length / 2);
+        Point2d c(ksize / 2, ksize / 2);
+        line(kernel, Point(cvRound(c.x - dir.x), cvRound(c.y - dir.y)), Point(cvRound(c.x + dir.x), cvRound(c.y + dir.y)), Scalar(1));
+        kernel /= sum(kernel)[0];
+        filter2D(img, img, -1, kernel);
+    }
+
+    // turbidity: the scene fades towards the water colour, more so when the camera flies higher
+    double transmission = std::pow(1 - settings.turbidity, s);
+    addWeighted(img, transmission, Mat(fs, CV_8UC3, Scalar(110, 90, 30)), 1 - transmission, 0, img);
+
+    // marine snow: small bright particles close to the camera, uncorrelated between frames
+    for (int i = 0; i < settings.snow; i++) {
+        Point p(rng.uniform(0, fs.width), rng.uniform(0, fs.height));
+        int radius = rng.uniform(1, std::max(2, fs.width / 480));
+        circle(img, p, radius, Scalar::all(rng.uniform(170, 255)), -1);
+    }
+
+    if (settings.noise > 0) {
+        Mat noise(fs, CV_16SC3);
+        rng.fill(noise, RNG::NORMAL, 0, settings.noise);
+        add(img, noise, img, noArray(), CV_8U);
+    }
+    return img;
+}
+
+float trueOverlap(const Mat &poseObject, const Mat &poseScene, Size frameSize) {
+    // frames are resized to TARGET_WIDTH before estimating the homography between them
+    double s = (double) TARGET_WIDTH / frameSize.width;
+    Mat S = (Mat_<double>(3, 3) << s, 0, 0, 0, s, 0, 0, 0, 1);
+    Mat H = S * poseScene.inv() * poseObject * S.inv();
+    return overlapArea(H, Size(TARGET_WIDTH, cvRound(frameSize.height * s)));
+}
+
+bool writeTrajectory(const string &filename, const vector<Mat> &poses, Size frameSize) {
+    ofstream file(filename.c_str());
+    if (!file) return false;
+    file << "frame,width,height,h00,h01,h02,h10,h11,h12,h20,h21,h22" << endl;
+    file << setprecision(17);
+    for (size_t i = 0; i < poses.size(); i++) {
+        file << i << "," << frameSize.width << "," << frameSize.height;
+        const double *h = poses[i].ptr<double>(0);
+        for (int j = 0; j < 9; j++) file << "," << h[j];
+        file << endl;
+    }
+    return file.good();
+}
+
+bool readTrajectory(const string &filename, vector<Mat> &poses, Size &frameSize) {
+    ifstream file(filename.c_str());
+    if (!file) return false;
+    string line;
+    getline(file, line);        // header
+    poses.clear();
+    while (getline(file, line)) {
+        vector<double> values;
+        stringstream row(line);
+        string field;
+        while (getline(row, field, ',')) values.push_back(atof(field.c_str()));
+        if (values.size() != 12 || (size_t) values[0] != poses.size()) return false;
+        frameSize = Size((int) values[1], (int) values[2]);
+        poses.push_back(Mat(3, 3, CV_64F, &values[3]).clone());
+    }
+    return !poses.empty();
+}
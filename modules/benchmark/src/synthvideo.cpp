@@ -0,0 +1,117 @@
+/********************************************************************/
+/* Project: uwimageproc							*/
+/* Module: 	benchmark						*/
+/* File: 	synthvideo.cpp                                          */
+/* Created:		17/10/2026                                          */
+/* Description
+	uwsynth: renders a synthetic underwater survey video over a seeded seabed texture, along a
+	known camera trajectory, and writes that trajectory next to the video. Used as reproducible
+	input for the end-to-end throughput harness (uwthroughput).
+*/
+/********************************************************************/
+
+#include "../../videostrip/include/videostrip.hpp"
+#include "../include/synthetic.h"
+#include "../include/synth_options.h"
+
+/*!
+	@fn		int main(int argc, char* argv[])
+	@brief	Main function
+*/
+int main(int argc, char *argv[]) {
+
+//*********************************************************************************
+/*	PARSER section */
+    argParser.Description("uwsynth - renders a synthetic underwater survey video along a known camera trajectory, "
+                          "with motion blur, turbidity, marine snow and sensor noise");
+    argParser.Epilog("Visit [https://github.com/mecatronicaUSB] for project information\n");
+    argParser.Prog(argv[0]);
+    argParser.helpParams.width = 120;
+
+    try{
+        argParser.ParseCLI(argc, argv);
+    }
+    catch (args::Help){    // if argument asking for help, show this message
+        cout << argParser;
+        return 1;
+    }
+    catch (const args::ParseError &e){  //if some error ocurr while parsing, show summary
+        std::cerr << e.what() << std::endl;
+        std::cerr << "Use -h, --help command to see usage" << std::endl;
+        return 1;
+    }
+
+    if (!argOutput) {
+        cerr << "Mandatory <output> file name missing" << endl;
+        cerr << "Use -h, --help command to see usage" << endl;
+        return 1;
+    }
+    string outputFile = args::get(argOutput);
+    string trajectoryFile = argTrajectory ? args::get(argTrajectory) : outputFile + ".trajectory.csv";
+
+    SurveySettings settings;
+    if (argResolution) {
+        int width = 0, height = 0;
+        char x = 0;
+        stringstream resolution(args::get(argResolution));
+        if (!(resolution >> width >> x >> height) || x != 'x' || width <= 0 || height <= 0) {
+            cerr << red << "Invalid resolution: " << args::get(argResolution) << " (expected WxH)" << reset << endl;
+            return 1;
+        }
+        settings.frameSize = Size(width, height);
+    }
+    if (argFrames) settings.nFrames = args::get(argFrames);
+    if (argSpeed) settings.speed = args::get(argSpeed);
+    if (argSway) settings.sway = args::get(argSway);
+    if (argYaw) settings.yaw = args::get(argYaw);
+    if (argAltitude) settings.altitude = args::get(argAltitude);
+    if (argExposure) settings.exposure = args::get(argExposure);
+    if (argTurbidity) settings.turbidity = args::get(argTurbidity);
+    if (argNoise) settings.noise = args::get(argNoise);
+    if (argSnow) settings.snow = args::get(argSnow);
+    if (argSeed) settings.seed = args::get(argSeed);
+    double fps = argFPS ? args::get(argFPS) : 25.0;
+    string codec = argCodec ? args::get(argCodec) : "MJPG";
+
+    if (settings.nFrames <= 0 || settings.speed <= 0 || fps <= 0 || settings.turbidity < 0 || settings.turbidity >= 1
+            || settings.altitude < 0 || settings.altitude >= 1) {
+        cerr << red << "Invalid survey settings: frames, speed and fps must be positive, turbidity and altitude in [0, 1)" << reset << endl;
+        return 1;
+    }
+    if (codec.size() != 4) {
+        cerr << red << "Invalid codec: " << codec << " (expected a fourcc code, e.g. MJPG)" << reset << endl;
+        return 1;
+    }
+
+    cout << cyan << "uwsynth" << reset << endl;
+    cout << "\tOutput:\t" << outputFile << endl;
+    cout << "\tSize:\t" << settings.frameSize.width << " x " << settings.frameSize.height << endl;
+    cout << "\tFrames:\t" << settings.nFrames << " @ " << fps << endl;
+    cout << "\tCodec:\t" << codec << endl;
+
+    SurveyRenderer renderer(settings);
+    cout << "\tSeabed:\t" << renderer.seabedSize().width << " x " << renderer.seabedSize().height << endl;
+
+    VideoWriter writer(outputFile, VideoWriter::fourcc(codec[0], codec[1], codec[2], codec[3]), fps, settings.frameSize, true);
+    if (!writer.isOpened()) {
+        cerr << red << "Unable to open video for writing: " << outputFile << " (codec " << codec << ")" << reset << endl;
+        return 1;
+    }
+
+    vector<Mat> poses;
+    for (int i = 0; i < settings.nFrames; i++) {
+        writer.write(renderer.render(i));
+        poses.push_back(renderer.pose(i));
+        if (i % 25 == 0 || i == settings.nFrames - 1)
+            cout << '\r' << yellow << "Frame: " << reset << i + 1 << "/" << settings.nFrames << std::flush;
+    }
+    writer.release();
+    cout << endl;
+
+    if (!writeTrajectory(trajectoryFile, poses, settings.frameSize)) {
+        cerr << red << "Unable to write trajectory: " << trajectoryFile << reset << endl;
+        return 1;
+    }
+    cout << green << "Trajectory written to: " << reset << trajectoryFile << endl;
+    return 0;
+}
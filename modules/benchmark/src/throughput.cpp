@@ -0,0 +1,228 @@
+/********************************************************************/
+/* Project: uwimageproc							*/
+/* Module: 	benchmark						*/
+/* File: 	throughput.cpp                                          */
+/* Created:		17/10/2026                                          */
+/* Description
+	uwthroughput: runs videostrip on a synthetic video written by uwsynth, and reports its
+	throughput (fps), peak memory (RSS), and the keyframes it selected checked against the known
+	camera trajectory: true overlap between consecutive keyframes, error of the estimated
+	overlaps, and broken chains.
+*/
+/********************************************************************/
+
+#include <cerrno>
+#include <cstring>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../../videostrip/include/videostrip.hpp"
+#include "../include/synthetic.h"
+#include "../include/throughput_options.h"
+
+#define DEFAULT_PREFIX      "throughput_"   //< Output prefix of the videostrip run
+#define DEFAULT_MIN_OVERLAP 0.05            //< True overlap below which two consecutive keyframes are disconnected
+
+/// Keyframes listed in a videostrip report, and the overlap threshold of the run
+struct RunReport {
+    double targetOverlap;
+    vector<int> frames;
+    vector<float> overlaps;     // estimated overlap that triggered each keyframe
+};
+
+static bool readReport(const string &filename, RunReport &report) {
+    ifstream file(filename.c_str());
+    if (!file) return false;
+    report.targetOverlap = OVERLAP_MIN;
+    string line;
+    bool table = false;
+    while (getline(file, line)) {
+        if (line.compare(0, 18, "Target minOverlap:") == 0) report.targetOverlap = atof(line.substr(18).c_str());
+        else if (line.compare(0, 9, "ID\tFrame\t") == 0) table = true;
+        else if (table) {
+            // ID, frame, filename, overlap, blur. The table ends with the summary lines
+            stringstream row(line);
+            int id, frame;
+            string name;
+            float overlap;
+            if (!(row >> id >> frame >> name >> overlap)) break;
+            report.frames.push_back(frame);
+            report.overlaps.push_back(overlap);
+        }
+    }
+    return table;
+}
+
+/*!
+	@fn		int main(int argc, char* argv[])
+	@brief	Main function
+*/
+int main(int argc, char *argv[]) {
+
+//*********************************************************************************
+/*	PARSER section */
+    argParser.Description("uwthroughput - runs videostrip on a synthetic video, and reports its throughput, peak memory "
+                          "and keyframe overlaps measured against the known camera trajectory");
+    argParser.Epilog("Visit [https://github.com/mecatronicaUSB] for project information\n");
+    argParser.Prog(argv[0]);
+    argParser.helpParams.width = 120;
+
+    try{
+        argParser.ParseCLI(argc, argv);
+    }
+    catch (args::Help){    // if argument asking for help, show this message
+        cout << argParser;
+        return 1;
+    }
+    catch (const args::ParseError &e){  //if some error ocurr while parsing, show summary
+        std::cerr << e.what() << std::endl;
+        std::cerr << "Use -h, --help command to see usage" << std::endl;
+        return 1;
+    }
+
+    if (!argInput || !argTrajectory) {
+        cerr << "Mandatory <video> and <trajectory> file names missing" << endl;
+        cerr << "Use -h, --help command to see usage" << endl;
+        return 1;
+    }
+    string videostrip = argVideostrip ? args::get(argVideostrip) : "videostrip";
+    string prefix = argPrefix ? args::get(argPrefix) : DEFAULT_PREFIX;
+    double minOverlap = argMinOverlap ? args::get(argMinOverlap) : DEFAULT_MIN_OVERLAP;
+
+    vector<Mat> poses;
+    Size frameSize;
+    if (!readTrajectory(args::get(argTrajectory), poses, frameSize)) {
+        cerr << red << "Unable to read trajectory: " << args::get(argTrajectory) << reset << endl;
+        return 1;
+    }
+
+    //**************************************************************************
+    /* VIDEOSTRIP RUN */
+    // headless, so the keyboard polling does not limit the throughput
+    vector<string> command;
+    command.push_back(videostrip);
+    command.push_back("--headless");
+    if (argOptions) {
+        vector<string> options = args::get(argOptions);
+        command.insert(command.end(), options.begin(), options.end());
+    }
+    command.push_back(args::get(argInput));
+    command.push_back(prefix);
+
+    cout << cyan << "uwthroughput" << reset << endl << "\tCommand:\t";
+    for (size_t i = 0; i < command.size(); i++) cout << command[i] << " ";
+    cout << endl;
+
+    vector<char*> childArgs;
+    for (size_t i = 0; i < command.size(); i++) childArgs.push_back(const_cast<char*>(command[i].c_str()));
+    childArgs.push_back(NULL);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid < 0) {
+        cerr << red << "Unable to start videostrip: " << strerror(errno) << reset << endl;
+        return 1;
+    }
+    if (pid == 0) {
+        // videostrip output goes to the console, as in a manual run
+        execvp(childArgs[0], &childArgs[0]);
+        cerr << red << "Unable to run " << videostrip << ": " << strerror(errno) << reset << endl;
+        _exit(127);
+    }
+    int status = 0;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0) {
+        cerr << red << "Unable to wait for videostrip: " << strerror(errno) << reset << endl;
+        return 1;
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        cerr << red << "videostrip failed (status " << (WIFEXITED(status) ? WEXITSTATUS(status) : -1) << ")" << reset << endl;
+        return 1;
+    }
+
+    //**************************************************************************
+    /* KEYFRAMES AGAINST THE TRAJECTORY */
+    RunReport report;
+    string reportFile = prefix + "videostrip_report.txt";
+    if (!readReport(reportFile, report)) {
+        cerr << red << "Unable to read videostrip report: " << reportFile << reset << endl;
+        return 1;
+    }
+
+    // true overlap between every pair of consecutive keyframes. The selection triggers the search below the target,
+    // and the refinement window only moves further away, so a good estimator keeps them close below the target
+    int nBroken = 0;
+    double sumOverlap = 0, sumError = 0, minTrue = 1, maxTrue = 0;
+    int nPairs = 0;
+    // error of the overlap videostrip estimated for each keyframe (failed estimates, below 0, are left out). The
+    // estimate is taken on the frame that triggered the search, so with a refinement window (-k) the error also
+    // includes the motion until the selected frame
+    double sumEstimateError = 0, maxEstimateError = 0;
+    int nEstimates = 0;
+    for (size_t k = 1; k < report.frames.size(); k++) {
+        int prev = report.frames[k - 1], curr = report.frames[k];
+        if (prev < 0 || curr >= (int) poses.size() || prev >= curr) continue;
+        double overlap = trueOverlap(poses[curr], poses[prev], frameSize);
+        if (overlap < minOverlap) nBroken++;
+        sumOverlap += overlap;
+        sumError += std::fabs(overlap - report.targetOverlap);
+        if (report.overlaps[k] >= 0) {
+            double estimateError = std::fabs(report.overlaps[k] - overlap);
+            sumEstimateError += estimateError;
+            maxEstimateError = std::max(maxEstimateError, estimateError);
+            nEstimates++;
+        }
+        minTrue = std::min(minTrue, overlap);
+        maxTrue = std::max(maxTrue, overlap);
+        nPairs++;
+    }
+
+    // keyframes of an ideal selector, triggered by the true overlap (without the blur refinement)
+    int idealKeyframes = poses.empty() ? 0 : 1;
+    for (size_t i = 1, key = 0; i < poses.size(); i++) {
+        if (trueOverlap(poses[i], poses[key], frameSize) < report.targetOverlap) {
+            key = i;
+            idealKeyframes++;
+        }
+    }
+
+    double fps = poses.size() / std::max(elapsed, 1e-6);
+    long peakRSS = usage.ru_maxrss;     // KB on Linux
+    cout << endl << "***************************************" << endl;
+    cout << "Frames:\t\t\t" << poses.size() << " (" << frameSize.width << " x " << frameSize.height << ")" << endl;
+    cout << "Wall time:\t\t" << elapsed << " s" << endl;
+    cout << "Throughput:\t\t" << green << fps << " fps" << reset << endl;
+    cout << "Peak RSS:\t\t" << peakRSS / 1024.0 << " MB" << endl;
+    cout << "Keyframes:\t\t" << report.frames.size() << " (ideal: " << idealKeyframes << ")" << endl;
+    cout << "Target overlap:\t\t" << report.targetOverlap << endl;
+    if (nPairs > 0) {
+        cout << "True overlap:\t\t" << sumOverlap / nPairs << " mean, [" << minTrue << ", " << maxTrue << "]" << endl;
+        cout << "Error to target:\t" << sumError / nPairs << " mean" << endl;
+    }
+    if (nEstimates > 0)
+        cout << "Estimate error:\t\t" << sumEstimateError / nEstimates << " mean, " << maxEstimateError << " max ("
+             << nEstimates << " keyframes)" << endl;
+    if (nBroken > 0)
+        cout << red << "Broken chain:\t\t" << nBroken << " consecutive keyframes overlap less than " << minOverlap << reset << endl;
+
+    if (argCSV) {
+        string csvName = args::get(argCSV);
+        bool exists = ifstream(csvName.c_str()).good();
+        ofstream csv(csvName.c_str(), std::ofstream::app);
+        if (!exists)
+            csv << "video,width,height,frames,seconds,fps,peak_rss_kb,keyframes,ideal_keyframes,target,"
+                   "mean_overlap,min_overlap,max_overlap,mean_error,mean_estimate_error,max_estimate_error,broken" << endl;
+        csv << args::get(argInput) << "," << frameSize.width << "," << frameSize.height << "," << poses.size() << ","
+            << elapsed << "," << fps << "," << peakRSS << "," << report.frames.size() << "," << idealKeyframes << ","
+            << report.targetOverlap << "," << (nPairs ? sumOverlap / nPairs : 0) << "," << (nPairs ? minTrue : 0) << ","
+            << (nPairs ? maxTrue : 0) << "," << (nPairs ? sumError / nPairs : 0) << ","
+            << (nEstimates ? sumEstimateError / nEstimates : 0) << "," << maxEstimateError << "," << nBroken << endl;
+        if (!csv) {
+            cerr << red << "Unable to write summary: " << csvName << reset << endl;
+            return 1;
+        }
+    }
+    return (nBroken > 0) ? 2 : 0;
+}
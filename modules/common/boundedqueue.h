@@ -0,0 +1,91 @@
+/**
+ * @file boundedqueue.h
+ * @brief Thread-safe FIFO queue with fixed capacity, used to connect producer/consumer stages
+ * @version 1.0
+ * @date 17/10/2026
+ */
+#ifndef _BOUNDEDQUEUE_H_
+#define _BOUNDEDQUEUE_H_
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * @brief Blocking queue with bounded capacity.
+ *
+ * push() blocks while the queue is full and pop() blocks while it is empty, so a fast producer
+ * cannot run arbitrarily ahead of a slow consumer. Once close() is called, push() fails immediately
+ * and pop() keeps returning the remaining items until the queue is drained.
+ *
+ * @code{.cpp}
+    BoundedQueue<Mat> queue(8);
+    // producer thread
+    while (capture.read(frame)) queue.push(frame.clone());
+    queue.close();
+    // consumer thread
+    Mat img;
+    while (queue.pop(img)) process(img);
+ * @endcode
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity > 0 ? capacity : 1), closed(false) {}
+
+    /**
+     * @brief Appends an item, waiting for free space if the queue is full
+     * @retval false if the queue was closed before the item could be inserted
+     */
+    bool push(const T &item) {
+        std::unique_lock<std::mutex> lock(mtx);
+        notFull.wait(lock, [this] { return closed || items.size() < capacity; });
+        if (closed) return false;
+        items.push_back(item);
+        notEmpty.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest item, waiting for one to arrive if the queue is empty
+     * @retval false if the queue is closed and there are no items left
+     */
+    bool pop(T &item) {
+        std::unique_lock<std::mutex> lock(mtx);
+        notEmpty.wait(lock, [this] { return closed || !items.empty(); });
+        if (items.empty()) return false;
+        item = items.front();
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    /// Stops accepting new items and wakes up every waiting thread
+    void close() {
+        std::lock_guard<std::mutex> lock(mtx);
+        closed = true;
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+
+    /// Drops every pending item (used when aborting a stage)
+    void clear() {
+        std::lock_guard<std::mutex> lock(mtx);
+        items.clear();
+        notFull.notify_all();
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return items.size();
+    }
+
+private:
+    size_t capacity;
+    bool closed;
+    std::deque<T> items;
+    std::mutex mtx;
+    std::condition_variable notEmpty, notFull;
+};
+
+#endif // _BOUNDEDQUEUE_H_
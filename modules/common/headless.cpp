@@ -0,0 +1,106 @@
+/********************************************************************/
+/* Project: uwimageproc							*/
+/* Module: 	common							*/
+/* File: 	headless.cpp                                            */
+/* Created:		17/10/2026                                          */
+/* Description
+	Graceful stop on SIGINT/SIGTERM and status file for unattended (headless) runs.
+*/
+/********************************************************************/
+
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+#include "headless.h"
+
+static volatile std::sig_atomic_t stopSignal = 0;
+
+static void stopHandler(int sig) {
+    // the first signal asks for a graceful stop, a second one falls back to the default action
+    if (stopSignal) {
+        std::signal(sig, SIG_DFL);
+        std::raise(sig);
+        return;
+    }
+    stopSignal = sig;
+}
+
+void installStopHandler() {
+    std::signal(SIGINT, stopHandler);
+    std::signal(SIGTERM, stopHandler);
+}
+
+bool stopRequested() {
+    return stopSignal != 0;
+}
+
+// quoted JSON string
+static std::string jsonString(const std::string &s) {
+    std::ostringstream out;
+    out << '"';
+    for (size_t i = 0; i < s.size(); i++) {
+        char c = s[i];
+        if (c == '"' || c == '\\') out << '\\' << c;
+        else if (c == '\n') out << "\\n";
+        else if (c == '\t') out << "\\t";
+        else if ((unsigned char) c < 0x20) out << ' ';
+        else out << c;
+    }
+    out << '"';
+    return out.str();
+}
+
+StatusFile::StatusFile(const std::string &path, const std::string &module) :
+    path(path),
+    module(module),
+    start(std::chrono::steady_clock::now()),
+    last(start),
+    written(false) {
+}
+
+void StatusFile::set(const std::string &key, const std::string &value) {
+    std::lock_guard<std::mutex> lock(mtx);
+    values[key] = jsonString(value);
+}
+
+void StatusFile::set(const std::string &key, double value) {
+    std::ostringstream out;
+    if (std::isfinite(value)) out << value;
+    else out << "null";
+    std::lock_guard<std::mutex> lock(mtx);
+    values[key] = out.str();
+}
+
+void StatusFile::set(const std::string &key, int value) {
+    std::lock_guard<std::mutex> lock(mtx);
+    values[key] = std::to_string(value);
+}
+
+void StatusFile::update(const std::string &state, bool force) {
+    if (path.empty()) return;
+    std::lock_guard<std::mutex> lock(mtx);
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (!force && written && std::chrono::duration<double>(now - last).count() < STATUS_PERIOD) return;
+    last = now;
+    written = true;
+    write(state);
+}
+
+void StatusFile::write(const std::string &state) {
+    double elapsed = std::chrono::duration<double>(last - start).count();
+    std::string tmpPath = path + ".tmp";
+    std::ofstream file(tmpPath.c_str(), std::ofstream::out);
+    if (!file) return;      // the status file is informative, never a reason to abort the run
+
+    file << "{\"module\": " << jsonString(module) << ", \"state\": " << jsonString(state)
+         << ", \"pid\": " << getpid() << ", \"elapsed\": " << elapsed;
+    for (std::map<std::string, std::string>::const_iterator it = values.begin(); it != values.end(); ++it)
+        file << ", " << jsonString(it->first) << ": " << it->second;
+    file << "}" << std::endl;
+    file.close();
+    std::rename(tmpPath.c_str(), path.c_str());
+}
@@ -0,0 +1,71 @@
+/**
+ * @file headless.h
+ * @brief Support for unattended runs: graceful stop on SIGINT/SIGTERM and a machine-readable status file
+ * @version 1.0
+ * @date 17/10/2026
+ *
+ * Modules built with -DHEADLESS (cmake -DHEADLESS=ON) do not include nor link HighGUI, so they never open a
+ * window nor wait for the keyboard. In any build, installStopHandler() turns SIGINT and SIGTERM into a flag that
+ * the processing loops poll, so partial results are flushed before exiting. A second signal stops immediately.
+ */
+#ifndef _HEADLESS_H_
+#define _HEADLESS_H_
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <chrono>
+
+#define STATUS_PERIOD   1.0     //< Minimum time between two rewrites of the status file, in seconds
+
+/// Installs the SIGINT/SIGTERM handlers. Safe to call more than once
+void installStopHandler();
+
+/// True once SIGINT or SIGTERM has been received
+bool stopRequested();
+
+/**
+ * @brief Progress of a run, written as a flat JSON object that other tools can poll
+ *
+ * Values are set at any time with set(), and written by update(). The file is replaced atomically (written to a
+ * temporary file, then renamed), so readers never see a partial file, and rewrites are limited to one every
+ * STATUS_PERIOD seconds unless forced. The object is thread safe. With an empty path nothing is written, so
+ * callers do not need to check whether the status file was requested.
+ *
+ * @code{.json}
+    {"module": "videostrip", "state": "running", "pid": 4242, "elapsed": 12.5, "frame": 1800, "keyframes": 31}
+ * @endcode
+ */
+class StatusFile {
+public:
+    /**
+     * @param path      Status file. Empty to disable it
+     * @param module    Name of the module, written in every update
+     */
+    StatusFile(const std::string &path, const std::string &module);
+
+    /// Whether a status file was requested
+    bool enabled() const { return !path.empty(); }
+
+    void set(const std::string &key, const std::string &value);
+    void set(const std::string &key, double value);
+    void set(const std::string &key, int value);
+
+    /**
+     * @brief Writes the current values
+     * @param state     Run state: "running", "stopped", "done" or "failed"
+     * @param force     Write even if the last update was less than STATUS_PERIOD seconds ago
+     */
+    void update(const std::string &state, bool force = false);
+
+private:
+    void write(const std::string &state);
+
+    std::string path, module;
+    std::map<std::string, std::string> values;      // already formatted as JSON values
+    std::chrono::steady_clock::time_point start, last;
+    bool written;
+    std::mutex mtx;
+};
+
+#endif // _HEADLESS_H_
@@ -20,6 +20,10 @@
 	Currently being handled in a separate branch
 */
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
 #include "preprocessing.h"
 
 void getHistogram(cv::Mat *img, cv::Mat *dstHist){
@@ -70,79 +74,181 @@ void printHistogram(int histogram[256], std::string filename, cv::Scalar color){
 // */
 
 
-// Now it will operate in a single channel of the provided image. So, future implementations will require a function call per channel (still faster)
-void imgChannelStretch(cv::Mat imgOriginal, cv::Mat imgStretched, int lowerPercentile, int higherPercentile){
-    // Computing the histograms
-    cv::Mat histogram;
-
-    getHistogram(&imgOriginal, &histogram);
-    // printHistogram(histogram, "inputCPU.jpg", 255);
-
-    // Computing the percentiles. We force invalid values as initial values (just in case)
-    float channelLowerPercentile = -1.0, channelHigherPercentile = -1.0;
-    int height = imgOriginal.size().height;
-    int width = imgOriginal.size().width;
-    int i = 0;
-    float sum = 0.0;
-	float normImgSize = height * width / 100.0;
-
-	while ( sum < higherPercentile * normImgSize ){
-        if(sum < lowerPercentile * normImgSize) channelLowerPercentile++; 
-        channelHigherPercentile++;
-        sum += histogram.at<float>(i,0);
-        i++;
+void ChannelHistograms::clear(){
+    channels = 0;
+    total = 0;
+    memset(count, 0, sizeof(count));
+    memset(cumulative, 0, sizeof(cumulative));
+}
+
+int ChannelHistograms::percentile(int channel, double percent) const{
+    double target = percent * total / 100.0;
+    // cumulative counts are sorted: binary search of the first one reaching the target
+    const uint64_t *c = cumulative[channel];
+    int lo = 0, hi = 255;
+    while (lo < hi){
+        int mid = (lo + hi) / 2;
+        if (c[mid] >= target) hi = mid;
+        else lo = mid + 1;
+    }
+    return lo;
+}
+
+// Counts the tiles [range.start, range.end) of an image, each one into its own sub-histogram
+class HistogramTiles : public cv::ParallelLoopBody {
+public:
+    HistogramTiles(const cv::Mat &img, std::vector<uint32_t> &partial) : img(img), partial(partial) {}
+
+    void operator()(const cv::Range &range) const {
+        const int cn = img.channels(), cols = img.cols;
+        for (int t = range.start; t < range.end; t++){
+            uint32_t *h = &partial[(size_t) t * cn * 256];
+            int last = std::min(img.rows, (t + 1) * HIST_TILE_ROWS);
+            for (int y = t * HIST_TILE_ROWS; y < last; y++){
+                const uchar *p = img.ptr<uchar>(y);
+                if (cn == 1){
+                    // two interleaved tables, so consecutive equal values do not wait for each other's increment
+                    uint32_t odd[256] = {0};
+                    int x = 0;
+                    for (; x + 1 < cols; x += 2){
+                        h[p[x]]++;
+                        odd[p[x + 1]]++;
+                    }
+                    if (x < cols) h[p[x]]++;
+                    for (int v = 0; v < 256; v++) h[v] += odd[v];
+                }
+                else if (cn == 3){
+                    uint32_t *h0 = h, *h1 = h + 256, *h2 = h + 512;
+                    for (int x = 0; x < cols; x++, p += 3){
+                        h0[p[0]]++;
+                        h1[p[1]]++;
+                        h2[p[2]]++;
+                    }
+                }
+                else{
+                    for (int x = 0; x < cols; x++, p += cn)
+                        for (int c = 0; c < cn; c++) h[c * 256 + p[c]]++;
+                }
+            }
+        }
+    }
+
+private:
+    const cv::Mat &img;
+    std::vector<uint32_t> &partial;
+};
+
+void getHistograms(const cv::Mat &img, ChannelHistograms &hist, bool accumulate){
+    CV_Assert(img.depth() == CV_8U && img.channels() <= 4);
+    const int cn = img.channels();
+    if (!accumulate || hist.channels != cn){
+        hist.clear();
+        hist.channels = cn;
     }
 
-    float b = - channelLowerPercentile;
-    float m = 255.0 / ( channelHigherPercentile - channelLowerPercentile );
+    // per tile counts fit in 32 bits (HIST_TILE_ROWS rows), and are merged in tile order into the 64 bit totals
+    int nTiles = (img.rows + HIST_TILE_ROWS - 1) / HIST_TILE_ROWS;
+    static thread_local std::vector<uint32_t> partial;     // reused by the following calls of this thread
+    partial.assign((size_t) nTiles * cn * 256, 0);
+    cv::parallel_for_(cv::Range(0, nTiles), HistogramTiles(img, partial), nTiles);
+    for (int t = 0; t < nTiles; t++){
+        const uint32_t *h = &partial[(size_t) t * cn * 256];
+        for (int c = 0; c < cn; c++)
+            for (int v = 0; v < 256; v++) hist.count[c][v] += h[c * 256 + v];
+    }
+    hist.total += (uint64_t) img.rows * img.cols;
 
-    imgStretched += b;
-    imgStretched *= m;
+    for (int c = 0; c < cn; c++){
+        uint64_t sum = 0;
+        for (int v = 0; v < 256; v++) hist.cumulative[c][v] = (sum += hist.count[c][v]);
+    }
+}
+
+void stretchLUT(const cv::Mat &histogram, int lowerPercentile, int higherPercentile, uchar lut[256]){
+    ChannelHistograms hist;
+    hist.channels = 1;
+    for (int i = 0; i < 256; i++){
+        hist.count[0][i] = (uint64_t) histogram.at<float>(i,0);
+        hist.total += hist.count[0][i];
+        hist.cumulative[0][i] = hist.total;
+    }
+    stretchLUT(hist, 0, lowerPercentile, higherPercentile, lut);
+}
+
+void stretchLUT(const ChannelHistograms &hist, int channel, int lowerPercentile, int higherPercentile, uchar lut[256]){
+    // Percentile bins, as the original cumulative search: the lower one is -1 when lowerPercentile is 0, and never
+    // above the higher one
+    float channelHigherPercentile = (higherPercentile > 0) ? hist.percentile(channel, higherPercentile) : -1;
+    float channelLowerPercentile = (lowerPercentile > 0) ?
+        std::min((float) hist.percentile(channel, lowerPercentile), channelHigherPercentile) : -1;
+
+    // the whole linear map is evaluated before saturating, once per value instead of once per pixel
+    float range = channelHigherPercentile - channelLowerPercentile;
+    for (int v = 0; v < 256; v++){
+        if (range > 0) lut[v] = cv::saturate_cast<uchar>((v - channelLowerPercentile) * 255.0 / range);
+        else lut[v] = (v > channelLowerPercentile) ? 255 : 0;     // a single value: plain threshold
+    }
+}
+
+cv::Mat stretchTable(const ChannelHistograms &hist, int lowerPercentile, int higherPercentile, int channelMask){
+    int cn = hist.channels;
+    cv::Mat table(1, 256, CV_8UC(cn));
+    uchar lut[256];
+    for (int c = 0; c < cn; c++){
+        if (channelMask & (1 << c)) stretchLUT(hist, c, lowerPercentile, higherPercentile, lut);
+        else for (int v = 0; v < 256; v++) lut[v] = (uchar) v;     // channel left untouched
+        for (int v = 0; v < 256; v++) table.ptr<uchar>(0)[v * cn + c] = lut[v];
+    }
+    return table;
+}
 
-    // getHistogram(imgStretched, histogram);
-    // printHistogram(histogram, "outputCPU.jpg", 255);
+// Each selected channel gets its own table, and all the channels are mapped by a single LUT pass. The histograms
+// of every channel are also counted in a single pass
+static cv::Mat stretchTable(const cv::Mat &imgOriginal, int lowerPercentile, int higherPercentile, int channelMask){
+    ChannelHistograms hist;
+    getHistograms(imgOriginal, hist);
+    return stretchTable(hist, lowerPercentile, higherPercentile, channelMask);
+}
 
+void imgChannelStretch(cv::Mat imgOriginal, cv::Mat imgStretched, int lowerPercentile, int higherPercentile, int channelMask){
+    cv::Mat table = stretchTable(imgOriginal, lowerPercentile, higherPercentile, channelMask);
+    cv::LUT(imgStretched, table, imgStretched);
 }
 
 #if USE_GPU
 // Now it will operate in a single channel of the provided image. So, future implementations will require a function call per channel (still faster)
-void imgChannelStretchGPU(cv::cuda::GpuMat imgOriginalGPU, cv::cuda::GpuMat imgStretchedGPU, int lowerPercentile, int higherPercentile){
+void imgChannelStretchGPU(cv::cuda::GpuMat imgOriginalGPU, cv::cuda::GpuMat imgStretchedGPU, int lowerPercentile, int higherPercentile, int channelMask){
     cv::Mat Original;
     imgOriginalGPU.download(Original);
 
-    // Computing the histograms
-    cv::Mat histogram;
-    getHistogram(&Original, &histogram);
-    // printHistogram(histogram, "inputGPU.jpg", 255);
-
-    // Computing the percentiles. We force invalid values as initial values (just in case)
-    float channelLowerPercentile = -1.0, channelHigherPercentile = -1.0;
-    float height = Original.size().height;
-    float width  = Original.size().width;
-    int i = 0;
-    float sum  = 0.0;
-
-	float normImgSize = height * width / 100.0;
-
-	while ( sum < higherPercentile * normImgSize ){
-        if(sum < lowerPercentile * normImgSize) channelLowerPercentile++; 
-        channelHigherPercentile++;
-        sum += histogram.at<float>(i,0);
-        i++;
-    }
+    // the table is built on the host, and applied on the device in a single pass
+    cv::Mat table = stretchTable(Original, lowerPercentile, higherPercentile, channelMask);
+    cv::cuda::createLookUpTable(table)->transform(imgStretchedGPU, imgStretchedGPU);
 
-    float m  = 255.0 / ( channelHigherPercentile - channelLowerPercentile );
-    float b  = - channelLowerPercentile;
+}
+#endif
 
-    cv::cuda::add(imgStretchedGPU, b, imgStretchedGPU);
-    cv::cuda::multiply(imgStretchedGPU, m, imgStretchedGPU);
+float aclaheEntropy(cv::Mat img){
+    float entropy = 0;
+    cv::Mat hist;      // 256-bin histogram (pixel count)
+    float histN[256];   // normalized histogram
 
-    imgStretchedGPU.download(Original);
-    // getHistogram(Original, histogram);
-    // printHistogram(histogram, "outputGPU.jpg", 255);
+    int width, height;
+    width = img.size().width;
+    height = img.size().height;
 
+    // Finds the image histogram
+    getHistogram(&img, &hist);
+    // Normalize the histogram, by the total number of pixels, and also convert it into log2
+    // Computes the entropy as the Shannon Index
+    for (int i=0; i< 256; i++){
+        histN[i] = hist.at<float>(i,0) / (width * height);
+        // we add 0.0000001 just in case there is a NULL bin in the histogram
+        entropy = entropy + ( histN[i] * log2(histN[i] + 0.00001));
+        // real entropy value is negative of this result
+    }
+    return (-entropy);
 }
-#endif
 
 int numChannel(char c){
     if(c == 'R' || c == 'H' || c == 'h' || c == 'L' || c == 'Y' ) return 0;  
@@ -159,3 +265,78 @@ int numSpace(char c){
     if(c == 'Y' || c == 'C' || c == 'X' ) return 4;
     return -1;
 }
+
+// conversions into and back from each colour space, indexed by numSpace (BGR needs none)
+static const int spaceConversions[5][2] = {{-1, -1},
+                                          {COLOR_BGR2HSV, COLOR_HSV2BGR},
+                                          {COLOR_BGR2HLS, COLOR_HLS2BGR},
+                                          {COLOR_BGR2Lab, COLOR_Lab2BGR},
+                                          {COLOR_BGR2YCrCb, COLOR_YCrCb2BGR}};
+
+int spaceConversion(int space, bool inverse){
+    return (space > 0 && space < 5) ? spaceConversions[space][inverse ? 1 : 0] : -1;
+}
+
+const char *spaceName(int space){
+    static const char *names[5] = {"BGR", "HSV", "HLS", "Lab", "YCrCb"};
+    return (space >= 0 && space < 5) ? names[space] : "unknown";
+}
+
+std::vector<ChannelStep> compileChannelPlan(const std::string &channels, std::string *unknown){
+    std::vector<ChannelStep> plan;
+    if (unknown) unknown->clear();
+    for (size_t i = 0; i < channels.size(); i++){
+        char c = channels[i];
+        int space = numSpace(c);
+        int channel = numChannel(c);
+        if (space < 0 || channel < 0){
+            if (unknown) *unknown += c;
+            continue;
+        }
+        // a channel stretched twice in a row sees the histogram left by the first stretch, so it needs its own step
+        if (plan.empty() || plan.back().space != space || (plan.back().channelMask & (1 << channel))){
+            ChannelStep step;
+            step.space = space;
+            step.channelMask = 0;
+            step.first = (int) i;
+            plan.push_back(step);
+        }
+        plan.back().channelMask |= 1 << channel;
+        plan.back().channels += c;
+    }
+    return plan;
+}
+
+bool applyChannelPlan(cv::Mat &img, const std::vector<ChannelStep> &plan, int lowerPercentile, int higherPercentile, bool (*stop)()){
+    cv::Mat converted;
+    for (size_t i = 0; i < plan.size(); i++){
+        if (stop && stop()) return false;
+        const ChannelStep &step = plan[i];
+        if (step.space == 0){
+            imgChannelStretch(img, img, lowerPercentile, higherPercentile, step.channelMask);
+            continue;
+        }
+        cv::cvtColor(img, converted, spaceConversion(step.space, false));
+        imgChannelStretch(converted, converted, lowerPercentile, higherPercentile, step.channelMask);
+        cv::cvtColor(converted, img, spaceConversion(step.space, true));
+    }
+    return true;
+}
+
+#if USE_GPU
+bool applyChannelPlanGPU(cv::cuda::GpuMat &img, const std::vector<ChannelStep> &plan, int lowerPercentile, int higherPercentile, bool (*stop)()){
+    cv::cuda::GpuMat converted;
+    for (size_t i = 0; i < plan.size(); i++){
+        if (stop && stop()) return false;
+        const ChannelStep &step = plan[i];
+        if (step.space == 0){
+            imgChannelStretchGPU(img, img, lowerPercentile, higherPercentile, step.channelMask);
+            continue;
+        }
+        cv::cuda::cvtColor(img, converted, spaceConversion(step.space, false), 3);
+        imgChannelStretchGPU(converted, converted, lowerPercentile, higherPercentile, step.channelMask);
+        cv::cuda::cvtColor(converted, img, spaceConversion(step.space, true), 3);
+    }
+    return true;
+}
+#endif
@@ -10,12 +10,16 @@
 #define HISTOGRAM_H
 
 #include <opencv2/core.hpp>
-#include <opencv2/highgui.hpp>
+#include <opencv2/imgcodecs.hpp>
+#ifndef HEADLESS
+    #include <opencv2/highgui.hpp>
+#endif
 #include <opencv2/imgproc.hpp>
 #include <string>
 #include <iostream>
 #include <iomanip>
 #include <sstream>
+#include <stdint.h>
 
 // CUDA libraries
 #if USE_GPU
@@ -38,6 +42,36 @@ using namespace cv;
 void getHistogram(cv::Mat *img, cv::Mat *dstHist);
 // Fix #15: Port to OpenCV histrogram calculation calcHist function
 
+#define HIST_TILE_ROWS  32      //< Rows of the tiles counted in parallel by getHistograms()
+
+/**
+ * @brief Histograms of every channel of an 8-bit image, with integer counts and cumulative counts
+ */
+struct ChannelHistograms {
+    int channels;
+    uint64_t total;                 // pixels counted
+    uint64_t count[4][256];         // pixels of each value, per channel
+    uint64_t cumulative[4][256];    // pixels with a value up to (and including) each one, per channel
+
+    ChannelHistograms() { clear(); }
+    void clear();
+
+    /// Smallest value whose cumulative count reaches the given percentage of the pixels (255 if none does)
+    int percentile(int channel, double percent) const;
+};
+
+/**
+ * @brief Computes the histograms of all the channels of an image in a single pass over its interleaved data
+ * @function getHistograms(const cv::Mat &img, ChannelHistograms &hist, bool accumulate)
+ * @param img OpenCV Matrix, 8-bit with one to four channels
+ * @param hist Output histograms, with their cumulative counts
+ * @param accumulate Add the counts of img to the ones already in hist (e.g. to combine the tiles of a large image)
+ * \n
+ * The image is split in tiles of HIST_TILE_ROWS rows, counted in parallel (cv::parallel_for_) into their own
+ * sub-histograms, which are merged once all are done. No channel is split, and no intermediate image is allocated.
+ */
+void getHistograms(const cv::Mat &img, ChannelHistograms &hist, bool accumulate=false);
+
 // TODO: Perhaps this function will be deprecated, or just kept back for visualization purposes (discuss it)
 /**
  * @brief Creates an image that represents the Histogram
@@ -48,27 +82,55 @@ void getHistogram(cv::Mat *img, cv::Mat *dstHist);
  */
 void printHistogram(int histogram[256], std::string filename, cv::Scalar color);
 
+/**
+ * @brief Builds the 256 entry lookup table that moves the lowerPercentile and higherPercentile values of a
+          histogram to 0 and 255, respectively. Values in between are linearly scaled, and saturated once
+ * @function stretchLUT(const cv::Mat &histogram, int lowerPercentile, int higherPercentile, uchar lut[256])
+ * @param histogram 256 bin histogram (CV_32F, as returned by getHistogram)
+ * @param lowerPercentile Percentile to trunk the lower values
+ * @param higherPercentile Percentile to trunk the higher values
+ * @param lut Output table
+ */
+void stretchLUT(const cv::Mat &histogram, int lowerPercentile, int higherPercentile, uchar lut[256]);
+
+/**
+ * @brief Same as stretchLUT(const cv::Mat&, ...), for one of the channels of a ChannelHistograms
+ */
+void stretchLUT(const ChannelHistograms &hist, int channel, int lowerPercentile, int higherPercentile, uchar lut[256]);
+
+/**
+ * @brief Lookup table (CV_8UC(channels)) stretching the channels of channelMask from their histograms, for cv::LUT
+ * @function stretchTable(const ChannelHistograms &hist, int lowerPercentile, int higherPercentile, int channelMask)
+ * \n
+ * Channels out of channelMask are mapped to themselves. Used when the histograms are accumulated apart from the
+ * image the table is applied to, e.g. over the tiles of an image too large to be loaded whole.
+ */
+cv::Mat stretchTable(const ChannelHistograms &hist, int lowerPercentile, int higherPercentile, int channelMask=~0);
+
 /**
  * @brief Transform imgOriginal so that, for each channel histogram, its
           lowerPercentile and higherPercentile values are moved to 0 and 255, respectively
- * @function imgChannelStretch(cv::Mat imgOriginal, cv::Mat imgStretched, int lowerPercentile, int higherPercentile)
- * @param imgOriginal OpenCV Matrix containing input image
+ * @function imgChannelStretch(cv::Mat imgOriginal, cv::Mat imgStretched, int lowerPercentile, int higherPercentile, int channelMask)
+ * @param imgOriginal OpenCV Matrix containing input image (8-bit, one to four channels)
  * @param imgStretched OpenCV Matrix to store the stretched output image
  * @param lowerPercentile Percentile to trunk the lower values
  * @param higherPercentile Percentile to trunk the higher values
+ * @param channelMask Channels to be stretched (bit c for channel c), the others are left untouched
  * \n
+ * The mapping of every channel is compiled into a lookup table (see stretchLUT), and all the channels
+ * are transformed by a single LUT pass over imgStretched.\n
  * \b CONSTRAINTS: \n
- * \e imgOriginal and \e imgStretched must have the same dimensions.\n
+ * \e imgOriginal and \e imgStretched must have the same dimensions and channels.\n
  * \e lowerPercentile and \e higherPercentle must be integers between
  * 0 and 100.\n
  * \e lowerPercentile must be smaller than \e higherPercentile
  */
-void imgChannelStretch(cv::Mat imgOriginal, cv::Mat imgStretched, int lowerPercentile=0, int higherPercentile=100);
+void imgChannelStretch(cv::Mat imgOriginal, cv::Mat imgStretched, int lowerPercentile=0, int higherPercentile=100, int channelMask=~0);
 // Transform imgOriginal so that, for each channel histogram, its
 // lowerPercentile and higherPercentile values are moved to 0 and 255,
 // respectively. Values in between are linearly scaled. Values smaller
 // than lowerPercentile are set to 0, and values greater than
-// higherPercentle are set to 1. The resulting image is saved in
+// higherPercentle are set to 255. The resulting image is saved in
 // imgStretched.
 // CONSTRAINTS:
 //      * imgOriginal and imgStretched must have the same dimensions.
@@ -80,11 +142,12 @@ void imgChannelStretch(cv::Mat imgOriginal, cv::Mat imgStretched, int lowerPerce
 /**
  * @brief GPU Implementation of transform imgOriginal so that, for each channel histogram, its
           lowerPercentile and higherPercentile values are moved to 0 and 255, respectively.
- * @function imgChannelStretchGPU(cv::cuda::GpuMat imgOriginal, cv::cuda::GpuMat imgStretched, int lowerPercentile, int higherPercentile)
+ * @function imgChannelStretchGPU(cv::cuda::GpuMat imgOriginal, cv::cuda::GpuMat imgStretched, int lowerPercentile, int higherPercentile, int channelMask)
  * @param imgOriginal OpenCV GpuMat containing input image
  * @param imgStretched OpenCV GpuMat to store the stretched output image
  * @param lowerPercentile Percentile to trunk the lower values
  * @param higherPercentile Percentile to trunk the higher values
+ * @param channelMask Channels to be stretched (bit c for channel c), the others are left untouched
  * \n
  * \b CONSTRAINTS: \n
  * \e imgOriginal and \e imgStretched must have the same dimensions.\n
@@ -93,12 +156,12 @@ void imgChannelStretch(cv::Mat imgOriginal, cv::Mat imgStretched, int lowerPerce
  * \e lowerPercentile must be smaller than \e higherPercentile. \n
  * \e CUDA 8.0 Required. 
  */
-void imgChannelStretchGPU(cv::cuda::GpuMat imgOriginal, cv::cuda::GpuMat imgStretched, int lowerPercentile, int higherPercentile);
+void imgChannelStretchGPU(cv::cuda::GpuMat imgOriginal, cv::cuda::GpuMat imgStretched, int lowerPercentile, int higherPercentile, int channelMask=~0);
 // Transform imgOriginal so that, for each channel histogram, its
 // lowerPercentile and higherPercentile values are moved to 0 and 255,
 // respectively. Values in between are linearly scaled. Values smaller
 // than lowerPercentile are set to 0, and values greater than
-// higherPercentle are set to 1. The resulting image is saved in
+// higherPercentle are set to 255. The resulting image is saved in
 // imgStretched. Use GPU capability
 // CONSTRAINTS:
 //      * imgOriginal and imgStretched must have the same dimensions.
@@ -108,10 +171,67 @@ void imgChannelStretchGPU(cv::cuda::GpuMat imgOriginal, cv::cuda::GpuMat imgStre
 //      * CUDA 8.0 Required.
 #endif
 
+/**
+ * @brief Computes the entropy (Shannon index) of a single channel image, usually the luminance channel
+ * @function aclaheEntropy(cv::Mat img)
+ * @param img OpenCV Matrix containing a single channel 8-bit image
+ * @return float Entropy of the intensity distribution, in bits
+ */
+float aclaheEntropy(cv::Mat img);
+
 // Function to obtain index of channel desired
 int numChannel(char c);
 
 // Function to obtain index of color space desired
 int numSpace(char c);
 
+/**
+ * @brief Step of a channel plan: channels stretched together in one colour space, between a single pair of conversions
+ */
+struct ChannelStep {
+    int space;          // colour space, as returned by numSpace (0: BGR, no conversion)
+    int channelMask;    // channels of that space to be stretched (bit c for channel c)
+    int first;          // position in the channel string of the first channel of the step
+    std::string channels;   // channel characters of the step, as given by the user
+};
+
+/**
+ * @brief Compiles a histretch channel string (e.g. "HSV" or "RHV") into the list of steps that apply it
+ * @function compileChannelPlan(const std::string &channels, std::string *unknown)
+ * @param channels Ordered list of channel characters (see numChannel and numSpace)
+ * @param unknown If not NULL, receives the characters not recognized, which are skipped
+ * @return Steps to be applied in order
+ * \n
+ * Consecutive channels of the same colour space are grouped in a single step, so the image is converted into that
+ * space once, all of them are stretched in a single pass, and it is converted back once. As every channel is stretched
+ * from its own histogram, the order within a step does not change the result. A new step is started when the space
+ * changes, or when a channel is repeated, so the user given order is kept between colour spaces.
+ */
+std::vector<ChannelStep> compileChannelPlan(const std::string &channels, std::string *unknown=NULL);
+
+/// Name of a colour space, as returned by numSpace
+const char *spaceName(int space);
+
+/// cvtColor code from BGR into a colour space (or back, if inverse), -1 for BGR itself
+int spaceConversion(int space, bool inverse=false);
+
+/**
+ * @brief Applies a channel plan to a BGR image, in place
+ * @function applyChannelPlan(cv::Mat &img, const std::vector<ChannelStep> &plan, int lowerPercentile, int higherPercentile)
+ * @param img 8-bit BGR image
+ * @param plan Steps returned by compileChannelPlan
+ * @param lowerPercentile Percentile to trunk the lower values (see imgChannelStretch)
+ * @param higherPercentile Percentile to trunk the higher values
+ * @param stop If not NULL, called before every step: the plan is interrupted when it returns true
+ * @retval false if the plan was interrupted
+ */
+bool applyChannelPlan(cv::Mat &img, const std::vector<ChannelStep> &plan, int lowerPercentile, int higherPercentile,
+                      bool (*stop)() = NULL);
+
+#if USE_GPU
+/// GPU version of applyChannelPlan
+bool applyChannelPlanGPU(cv::cuda::GpuMat &img, const std::vector<ChannelStep> &plan, int lowerPercentile, int higherPercentile,
+                         bool (*stop)() = NULL);
+#endif
+
 #endif
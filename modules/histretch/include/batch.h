@@ -0,0 +1,68 @@
+/**
+ * @file batch.h
+ * @brief Batch mode for histretch: stretches every image of a directory or file list on a pool of workers
+ * @version 1.0
+ * @date 17/10/2026
+ *
+ * Image paths are produced from a directory listing, a list file (one path per line) or the standard input, which
+ * allows streaming the frames as another tool exports them. Paths go through a BoundedQueue to a pool of workers,
+ * each one reading, stretching and writing one image at a time, so at most one image per worker (plus its colour
+ * space conversion) is held in memory, whatever the number of images. Images whose output is newer than the input
+ * are skipped, so an interrupted batch is completed by running it again.
+ *
+ * Outputs keep the file name of their input. When several inputs of a list share their file name, the repeated ones
+ * are written with a numeric suffix (frame.jpg, frame_1.jpg, ...) in list order, so the same list always gives the
+ * same names and no output overwrites another one.
+ */
+#ifndef _HISTRETCH_BATCH_H_
+#define _HISTRETCH_BATCH_H_
+
+#include <string>
+#include <vector>
+
+#include "../../common/preprocessing.h"
+#include "../../common/headless.h"
+
+#define BATCH_EXTENSIONS    "jpg jpeg png ppm pgm pnm bmp tif tiff"     //< Image files taken from a directory
+#define BATCH_QUEUE_FACTOR  4       //< Pending paths per worker
+#define BATCH_LOG_PERIOD    500     //< Processed images between two progress lines on the console
+
+/**
+ * @brief Settings of a batch run
+ */
+struct BatchSettings {
+    std::vector<ChannelStep> plan;  // compiled channel list (see compileChannelPlan)
+    int lowerPercentile;
+    int higherPercentile;
+    std::string outputDir;          // every output keeps the file name of its input (with a suffix if repeated)
+    int nWorkers;                   // images processed in parallel
+    bool force;                     // process the images even if their output is up to date
+
+    BatchSettings() : lowerPercentile(2), higherPercentile(98), nWorkers(1), force(false) {}
+};
+
+/**
+ * @brief Aggregated results of a batch run
+ */
+struct BatchTotals {
+    int processed, skipped, failed;
+    double megapixels;                  // of the processed images
+    double readTime, stretchTime, writeTime;   // accumulated over the workers, in seconds
+    double seconds;                     // wall-clock time
+
+    BatchTotals() : processed(0), skipped(0), failed(0), megapixels(0), readTime(0), stretchTime(0), writeTime(0),
+                    seconds(0) {}
+};
+
+/**
+ * @brief Stretches every image listed by input
+ * @param input     Directory (its image files, sorted by name), list file with one path per line, or "-" to read the
+ *                  list from the standard input as it arrives
+ * @param settings  Channel plan, percentiles, output directory and workers
+ * @param status    Progress is reported as "queued", "processed", "skipped" and "failed"
+ * @param totals    Counters and accumulated times of the run
+ * @retval false if the input could not be listed, or the output directory is the input directory
+ */
+bool processBatch(const std::string &input, const BatchSettings &settings, StatusFile &status, BatchTotals &totals);
+
+#endif // _HISTRETCH_BATCH_H_
@@ -0,0 +1,51 @@
+/**
+ * @file tiled.h
+ * @brief Tiled mode for histretch: stretches TIFF/BigTIFF mosaics too large to be loaded whole, in bounded memory
+ * @version 1.0
+ * @date 17/10/2026
+ *
+ * The image is never loaded whole: it is read one block (a tile of a tiled TIFF, or a strip of a striped one) at a
+ * time through libtiff. A first pass streams the blocks to accumulate the global histograms of the channels to be
+ * stretched (getHistograms with accumulate), and the stretch tables are built from them. A second pass applies the
+ * tables block by block, and writes every block to the output, which keeps the layout (tile or strip size) and the
+ * compression of the input. The result is the same as stretching the whole image, and the memory used is a few
+ * blocks, whatever the size of the image.
+ *
+ * Every step of a channel plan stretches the image left by the previous steps, so a plan with several colour
+ * spaces needs one histogram pass per step (the blocks are read again, with the previous steps applied on the fly).
+ * Plans within a single colour space, e.g. -c=HSV, take exactly two passes.
+ *
+ * Requires libtiff (USE_TIFF, set by cmake when libtiff is found).
+ */
+#ifndef _HISTRETCH_TILED_H_
+#define _HISTRETCH_TILED_H_
+
+#include <string>
+#include <vector>
+
+#include "../../common/preprocessing.h"
+#include "../../common/headless.h"
+
+#define TILED_BIGTIFF_SIZE  0xF0000000ULL   //< Uncompressed size above which the output is always written as BigTIFF
+#define TILED_MAX_BLOCK     (64 << 20)      //< Largest block (tile or strip) accepted, in bytes, to keep memory bounded
+#define TILED_JPEG_QUALITY  90              //< JPEG quality of the output, for JPEG compressed inputs
+
+/// Whether histretch was built with libtiff, so the tiled mode is available
+bool tiledSupported();
+
+/**
+ * @brief Stretches a TIFF/BigTIFF image block by block, in two passes (histograms, then stretch)
+ * @param input     8-bit RGB TIFF or BigTIFF, tiled or striped, with interleaved samples
+ * @param output    Output TIFF, with the same layout and compression. It is BigTIFF if the input is, or if the
+ *                  image is larger than TILED_BIGTIFF_SIZE
+ * @param plan      Compiled channel list (see compileChannelPlan)
+ * @param lowerPercentile   Percentile to trunk the lower values
+ * @param higherPercentile  Percentile to trunk the higher values
+ * @param status    Progress is reported as "pass", "passes" and "blocks_done"
+ * @retval false if the input is not supported, it could not be read or the output could not be written (the partial
+ *         output is removed), or the run was stopped
+ */
+bool stretchTiled(const std::string &input, const std::string &output, const std::vector<ChannelStep> &plan,
+                  int lowerPercentile, int higherPercentile, StatusFile &status);
+
+#endif // _HISTRETCH_TILED_H_
@@ -0,0 +1,218 @@
+/********************************************************************/
+/* Project: uwimageproc								                */
+/* Module: 	histretch	- Histogram Stretching		                */
+/* File: 	batch.cpp                                               */
+/* Created:		17/10/2026                                          */
+/* Description:
+    Batch mode: image paths from a directory, a list file or the standard input are
+    stretched by a pool of workers, skipping the images whose output is up to date.
+ */
+/********************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../include/batch.h"
+#include "../../common/boundedqueue.h"
+
+static std::mutex coutMutex;    // workers report failures from different threads
+
+// Image to stretch, and the file name of its output
+struct BatchItem {
+    string path;
+    string file;
+};
+
+// lower case extension of a file name, without the dot
+static string fileExtension(const string &file) {
+    size_t dot = file.find_last_of('.');
+    size_t slash = file.find_last_of('/');
+    if (dot == string::npos || (slash != string::npos && dot < slash)) return "";
+    string ext = file.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext;
+}
+
+static bool isDirectory(const string &path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+// both paths exist and are the same file (or directory), whatever the way they are written
+static bool sameFile(const string &a, const string &b) {
+    struct stat ia, ib;
+    if (stat(a.c_str(), &ia) != 0 || stat(b.c_str(), &ib) != 0) return false;
+    return ia.st_dev == ib.st_dev && ia.st_ino == ib.st_ino;
+}
+
+// the output exists and was written after the last change of the input
+static bool upToDate(const string &input, const string &output) {
+    struct stat in, out;
+    if (stat(input.c_str(), &in) != 0 || stat(output.c_str(), &out) != 0) return false;
+    return out.st_mtime >= in.st_mtime;
+}
+
+static string trim(const string &line) {
+    size_t first = line.find_first_not_of(" \t\r\n");
+    if (first == string::npos) return "";
+    return line.substr(first, line.find_last_not_of(" \t\r\n") - first + 1);
+}
+
+// queues an image, with the file name of its input as output name. Inputs of a list may share their file name (e.g.
+// frames of several dives, exported to different directories), the repeated ones get a numeric suffix
+static bool enqueue(BoundedQueue<BatchItem> &queue, std::set<string> &claimed, const string &path) {
+    BatchItem item;
+    item.path = path;
+    item.file = path.substr(path.find_last_of('/') + 1);
+    if (!claimed.insert(item.file).second) {
+        size_t dot = item.file.find_last_of('.');
+        string stem = item.file.substr(0, dot), ext = (dot == string::npos) ? "" : item.file.substr(dot);
+        string unique;
+        for (int n = 1; !claimed.insert(unique = stem + "_" + std::to_string(n) + ext).second; n++);
+        item.file = unique;
+        std::lock_guard<std::mutex> lock(coutMutex);
+        cerr << "Repeated file name, written as " << item.file << ": " << path << endl;
+    }
+    return queue.push(item);
+}
+
+// reads the list from the standard input as it arrives, waking up regularly to honour a stop request
+static void readStandardInput(BoundedQueue<BatchItem> &queue, std::set<string> &claimed, int &nQueued) {
+    string pending;
+    char buffer[4096];
+    while (!stopRequested()) {
+        struct pollfd fd = {STDIN_FILENO, POLLIN, 0};
+        int ready = poll(&fd, 1, 250);
+        if (ready < 0) break;
+        if (ready == 0) continue;
+        ssize_t n = read(STDIN_FILENO, buffer, sizeof(buffer));
+        if (n <= 0) break;      // end of the list
+        pending.append(buffer, n);
+        size_t end;
+        while ((end = pending.find('\n')) != string::npos) {
+            string path = trim(pending.substr(0, end));
+            pending.erase(0, end + 1);
+            if (!path.empty() && enqueue(queue, claimed, path)) nQueued++;
+        }
+    }
+    string path = trim(pending);
+    if (!path.empty() && !stopRequested() && enqueue(queue, claimed, path)) nQueued++;
+}
+
+bool processBatch(const string &input, const BatchSettings &settings, StatusFile &status, BatchTotals &totals) {
+    totals = BatchTotals();
+    bool fromDirectory = isDirectory(input);
+    if (fromDirectory && sameFile(input, settings.outputDir)) {
+        cerr << "The output directory can not be the input directory" << endl;
+        return false;
+    }
+    ifstream listFile;
+    if (!fromDirectory && input != "-") {
+        listFile.open(input.c_str());
+        if (!listFile.is_open()) return false;
+    }
+
+    int nWorkers = std::max(1, settings.nWorkers);
+    BoundedQueue<BatchItem> queue(nWorkers * BATCH_QUEUE_FACTOR);
+    std::atomic<int> nProcessed(0), nSkipped(0), nFailed(0);
+    std::mutex totalsMutex;
+    double t = (double) getTickCount();
+
+    // each worker reads, stretches and writes one image at a time, so memory does not grow with the list
+    auto worker = [&]() {
+        BatchItem item;
+        Mat img;
+        while (queue.pop(item)) {
+            if (stopRequested()) {
+                queue.close();      // also releases the listing, if it waits for room in the queue
+                break;
+            }
+            const string &path = item.path, &file = item.file;
+            string output = settings.outputDir + "/" + file;
+            // written under a hidden name (same extension, for the encoder) and renamed, so an image killed while
+            // being written is never taken as up to date by the next run
+            string partial = settings.outputDir + "/.~" + file;
+            if (!settings.force && upToDate(path, output)) {
+                status.set("skipped", ++nSkipped);
+                status.update("running");
+                continue;
+            }
+            double t0 = (double) getTickCount();
+            img = imread(path, IMREAD_COLOR);
+            double t1 = (double) getTickCount();
+            bool ok = !img.empty() && !sameFile(path, output);
+            if (ok) applyChannelPlan(img, settings.plan, settings.lowerPercentile, settings.higherPercentile);
+            double t2 = (double) getTickCount();
+            ok = ok && imwrite(partial, img) && std::rename(partial.c_str(), output.c_str()) == 0;
+            double t3 = (double) getTickCount();
+            if (!ok) {
+                std::remove(partial.c_str());
+                status.set("failed", ++nFailed);
+                std::lock_guard<std::mutex> lock(coutMutex);
+                cerr << "Unable to process: " << path << endl;
+                continue;
+            }
+            {
+                std::lock_guard<std::mutex> lock(totalsMutex);
+                totals.megapixels += img.total() * 1e-6;
+                totals.readTime += (t1 - t0) / getTickFrequency();
+                totals.stretchTime += (t2 - t1) / getTickFrequency();
+                totals.writeTime += (t3 - t2) / getTickFrequency();
+            }
+            int n = ++nProcessed;
+            status.set("processed", n);
+            status.update("running");
+            if (n % BATCH_LOG_PERIOD == 0) {
+                double elapsed = ((double) getTickCount() - t) / getTickFrequency();
+                std::lock_guard<std::mutex> lock(coutMutex);
+                cout << "\t" << n << " images, " << n / std::max(elapsed, 1e-3) << " images/s" << endl;
+            }
+        }
+    };
+    vector<std::thread> workers;
+    for (int w = 0; w < nWorkers; w++)
+        workers.push_back(std::thread(worker));
+
+    // this thread lists the images and names their outputs, blocking while the queue is full
+    int nQueued = 0;
+    std::set<string> claimed;      // output file names given so far
+    if (fromDirectory) {
+        vector<String> files;
+        glob(input, files, false);
+        std::sort(files.begin(), files.end());
+        istringstream known(BATCH_EXTENSIONS);
+        vector<string> extensions;
+        string ext;
+        while (known >> ext) extensions.push_back(ext);
+        for (size_t i = 0; i < files.size() && !stopRequested(); i++)
+            if (std::find(extensions.begin(), extensions.end(), fileExtension(files[i])) != extensions.end()
+                && enqueue(queue, claimed, files[i])) nQueued++;
+    }
+    else if (input == "-") readStandardInput(queue, claimed, nQueued);
+    else {
+        string line;
+        while (!stopRequested() && std::getline(listFile, line)) {
+            string path = trim(line);
+            if (!path.empty() && enqueue(queue, claimed, path)) nQueued++;
+        }
+    }
+    status.set("queued", nQueued);
+    queue.close();
+    for (int w = 0; w < nWorkers; w++)
+        workers[w].join();
+
+    totals.processed = nProcessed;
+    totals.skipped = nSkipped;
+    totals.failed = nFailed;
+    totals.seconds = ((double) getTickCount() - t) / getTickFrequency();
+    return true;
+}
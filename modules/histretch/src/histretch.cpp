@@ -26,15 +26,23 @@
 #include <iomanip>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <sys/stat.h>
 
 /// OpenCV libraries. May need review for the final release
 #include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#ifndef HEADLESS
 #include <opencv2/highgui.hpp>
+#endif
 #include <opencv2/imgproc.hpp>
 
 /// Include auxiliary utility libraries
 // TODO: change directory structure to math proposed template  (see mosaic repo)
 #include "../../common/preprocessing.h"
+#include "../../common/headless.h"
+#include "../include/batch.h"
+#include "../include/tiled.h"
 
 // C++ namespaces
 using namespace cv;
@@ -71,6 +79,12 @@ int main(int argc, char *argv[]) {
                     "{c       |r      | Channel to apply histogram equalization}"
                         "{cuda    |       | Use CUDA or not (CUDA ON: 1, CUDA OFF: 0)}"         // Use CUDA (if available) or not
                             "{time    |       | Show time measurements or not (ON: 1, OFF: 0)}" // Show time measurements or not
+                    "{headless |      | Do not show the source and resulting windows}"     // unattended run
+                    "{status  |       | Write the progress to this file, as a JSON object}"
+                    "{batch   |       | Batch mode: @input is a directory, a list file or '-' (stdin), @output a directory}"
+                    "{threads |0      | Batch workers (0: number of cores)}"
+                    "{force   |       | Batch mode: process the images even if their output is up to date}"
+                    "{tiled   |       | Tiled mode: @input and @output are TIFF/BigTIFF files, stretched block by block}"
                     "{help h usage ?  |       | show this help message}";         // optional, show help optional
 
     CommandLineParser cvParser(argc, argv, keys);
@@ -86,7 +100,7 @@ int main(int argc, char *argv[]) {
         cout << "Based on A. Longart Python prototype and OpenCV online documentation" << endl;
         cvParser.printMessage();
         cout << "Argument 'c=<channels>' is a string containing an ordered list of desired channels to be stretched" << endl;
-        cout << "Histogram stretching is applied one at time, and then converted back to RGB colour space" << endl;
+        cout << "Consecutive channels of the same colour space are stretched together, and then converted back to RGB colour space" << endl;
         cout << "Complete options are:" << endl;
         cout << "\t-c=R|G|B\tfor RGB space" << endl;
         cout << "\t-c=H|S|V\tfor HSV space" << endl;
@@ -94,10 +108,18 @@ int main(int argc, char *argv[]) {
         cout << "\t-c=L|a|b\tfor Lab space" << endl;
         cout << "\t-c=Y|C|X\tfor YCrCb space" << endl;
         cout << "\t-cuda=0 or -cuda=1 (CUDA ON: 1, CUDA OFF: 0, if available)" << endl;
+        cout << "\t-headless\tdo not open any window (always on in HEADLESS builds)" << endl;
+        cout << "\t-status=<file>\twrite the progress to <file> (JSON)" << endl;
+        cout << "\t-batch\tstretch every image of the directory or list file <input> into the directory <output>" << endl;
+        cout << "\t-threads=<n>\tnumber of batch workers (0: number of cores)" << endl;
+        cout << "\t-force\treprocess the images whose output is newer than the input" << endl;
+        cout << "\t-tiled\tstretch a TIFF mosaic too large to be loaded, one tile at a time (requires libtiff)" << endl;
         cout << endl << "\tExample:" << endl;
         cout << "\t$ histretch -c=HV input.jpg output.jpg -cuda=0 -time=1" << endl;
         cout <<
-        "\tThis will open 'input.jpg' file, operate on the 'H' and 'V' channels, and write it in 'output.jpg'" << endl << endl;
+        "\tThis will open 'input.jpg' file, operate on the 'H' and 'V' channels, and write it in 'output.jpg'" << endl;
+        cout << "\t$ histretch -c=HV -batch -threads=8 frames/ stretched/" << endl;
+        cout << "\tThis will stretch every image of 'frames/' and write it with the same name in 'stretched/'" << endl << endl;
         return 0;
     }
     int CUDA = 0;                                       //Default option (running with CPU)
@@ -109,6 +131,16 @@ int main(int argc, char *argv[]) {
 
     String cChannel = cvParser.get<cv::String>("c");	// gets argument -c=x, where 'x' is the image channel
     Time = cvParser.get<int>("time");	                // gets argument -time=x, where 'x' define to show time execution or not
+#ifdef HEADLESS
+    bool headless = true;                               // built without HighGUI
+#else
+    bool headless = cvParser.has("headless");           // gets argument -headless, no windows are shown
+#endif
+    StatusFile status(cvParser.has("status") ? cvParser.get<cv::String>("status") : "", "histretch");
+    bool batch = cvParser.has("batch");                 // gets argument -batch, input and output are directories
+    int nThreads = cvParser.get<int>("threads");        // gets argument -threads=x, number of batch workers
+    bool force = cvParser.has("force");                 // gets argument -force, up to date outputs are rewritten
+    bool tiled = cvParser.has("tiled");                 // gets argument -tiled, input is processed by tiles
 	// Check if occurred any error during parsing process
     if (! cvParser.check()) {
         cvParser.printErrors();
@@ -147,19 +179,105 @@ int main(int argc, char *argv[]) {
     cout << "Output: " << OutputFile << endl;
     cout << "Channel: " << cChannel  << endl;
 
-    Mat src, dst;
+    Mat src;
     const char* src_window = "Source image";
     const char* dst_window = "Destination image";
-    int num_convert = cChannel.length();
     int min_percent = 2, max_percent = 98;
-    int transformation[4][2] = {COLOR_BGR2HSV, COLOR_HSV2BGR, COLOR_BGR2HLS, COLOR_HLS2BGR, 
-                                COLOR_BGR2Lab, COLOR_Lab2BGR, COLOR_BGR2YCrCb, COLOR_YCrCb2BGR};
+
+    // The channel list is compiled once: consecutive channels of the same colour space share a single conversion
+    string unknown;
+    vector<ChannelStep> plan = compileChannelPlan(cChannel, &unknown);
+    for (size_t i = 0; i < unknown.size(); i++)
+        cout << "Option " << unknown[i] << " not recognized, skipping..." << endl;
+
+    // SIGINT/SIGTERM stop between steps, without writing a partially stretched image
+    installStopHandler();
+    status.set("input", InputFile);
+    status.set("output", OutputFile);
+    status.set("channels", cChannel);
+
+    //**************************************************************************
+    /* TILED MODE */
+    // The image is never loaded whole: histograms are accumulated over its tiles, then the tiles are stretched
+    if (tiled) {
+        if (!tiledSupported()) {
+            cout << "Tiled mode not available: histretch was built without libtiff" << endl;
+            status.update("failed", true);
+            return -1;
+        }
+        status.update("running", true);
+        t = (double) getTickCount();
+        bool done = stretchTiled(InputFile, OutputFile, plan, min_percent, max_percent, status);
+        t = ((double) getTickCount() - t) / getTickFrequency();
+        if (stopRequested()) {
+            cout << "hS: stop requested, output not written" << endl;
+            status.update("stopped", true);
+            return 1;
+        }
+        if (!done) {
+            cout << "Unable to process tiled image: " << InputFile << endl;
+            status.update("failed", true);
+            return -1;
+        }
+        cout << "Elapsed:\t" << t << " s" << endl;
+        status.update("done", true);
+        return 0;
+    }
+
+    //**************************************************************************
+    /* BATCH MODE */
+    // Unattended by design: no windows, runs on the CPU, one image per worker
+    if (batch) {
+        BatchSettings settings;
+        settings.plan = plan;
+        settings.lowerPercentile = min_percent;
+        settings.higherPercentile = max_percent;
+        settings.outputDir = OutputFile;
+        settings.nWorkers = (nThreads > 0) ? nThreads : std::max(1, (int) std::thread::hardware_concurrency());
+        settings.force = force;
+        // the pool already keeps every core busy, so each image is processed by a single thread
+        if (settings.nWorkers > 1) setNumThreads(1);
+        mkdir(OutputFile.c_str(), 0755);
+
+        BatchTotals totals;
+        status.update("running", true);
+        if (!processBatch(InputFile, settings, status, totals)) {
+            cout << "Unable to list the input images: " << InputFile << endl;
+            status.update("failed", true);
+            return -1;
+        }
+        cout << "***************************************" << endl;
+        cout << "Processed:\t" << totals.processed << " (" << totals.skipped << " up to date, " << totals.failed << " failed)" << endl;
+        cout << "Elapsed:\t" << totals.seconds << " s" << endl;
+        cout << "Throughput:\t" << totals.processed / std::max(totals.seconds, 1e-3) << " images/s, "
+             << totals.megapixels / std::max(totals.seconds, 1e-3) << " MPix/s (" << settings.nWorkers << " workers)" << endl;
+        if (totals.processed > 0)
+            cout << "Per image:\tread " << 1000 * totals.readTime / totals.processed << " ms, stretch "
+                 << 1000 * totals.stretchTime / totals.processed << " ms, write "
+                 << 1000 * totals.writeTime / totals.processed << " ms" << endl;
+        status.set("images_per_second", totals.processed / std::max(totals.seconds, 1e-3));
+        status.update(stopRequested() ? "stopped" : totals.failed ? "failed" : "done", true);
+        return stopRequested() ? 1 : (totals.failed ? -1 : 0);
+    }
 
     src = imread (InputFile,CV_LOAD_IMAGE_COLOR);
-    namedWindow( src_window, WINDOW_AUTOSIZE);
-    imshow (src_window, src);
+    if (src.empty()) {
+        cout << "Failed to read input image, exiting..." << endl;
+        status.update("failed", true);
+        return -1;
+    }
+#ifndef HEADLESS
+    if (!headless) {
+        namedWindow( src_window, WINDOW_AUTOSIZE);
+        imshow (src_window, src);
+    }
+#endif
+    status.update("running", true);
 
-    cout << "Applying " << num_convert << " histretch" << endl;
+    cout << "Applying " << plan.size() << " histretch steps" << endl;
+    for (size_t i = 0; i < plan.size(); i++)
+        cout << "\tStep[" << i << "]: " << plan[i].channels << " in " << spaceName(plan[i].space) << " space" << endl;
+    status.set("steps", (int) plan.size());
 
     // Start time measurement
     t = (double) getTickCount();
@@ -167,90 +285,15 @@ int main(int argc, char *argv[]) {
     // GPU Implementation
     #if USE_GPU
         if(CUDA){
-            GpuMat srcGPU, dstGPU;
-            GpuMat dstSpacesGPU[6][3];
-            Mat dstSpaces[6][3];
-
+            GpuMat srcGPU;
             srcGPU.upload(src);
-            dstGPU.upload(dst);
-
-            // Now, according to parameters provided at CLI calling time, we must split and process the image
-            for (int nc=0; nc<num_convert; nc++){
-                char c = cChannel[nc];
-                int channel = numChannel(c);
-                int space = numSpace(c);
-                cout << "\tChannel[" << nc << "]: " << c << endl;
-
-                // If the option is recognized
-                if(!(space == -1)){
-                    // Spaces HSV, hsl, Lab, YCX
-                    if(space == 1 || space == 2 || space == 3 || space == 4 ){
-                        // Convert space
-                        cuda::cvtColor(srcGPU, dstGPU, transformation[space - 1][0], 3);
-                        // Split channels
-                        cuda::split(dstGPU, dstSpacesGPU[space]);
-                        // Stretch of selected channel
-                        imgChannelStretchGPU(dstSpacesGPU[space][channel], dstSpacesGPU[space][channel], min_percent, max_percent);
-                        // Convert back to BGR space
-                        cuda::cvtColor(dstGPU, srcGPU, transformation[space - 1][1], 3);
-                        // Merge channels to dst
-                        cuda::merge (dstSpacesGPU[space], 3, dstGPU);
-                    }
-                    // Space BGR
-                    else{
-                        // Split channels
-                        cuda::split (srcGPU, dstSpacesGPU[space]);
-                        // Stretch of selected channel
-                        imgChannelStretchGPU(dstSpacesGPU[space][channel], dstSpacesGPU[space][channel], min_percent, max_percent);
-                        // Merge channels to src
-                        cuda::merge (dstSpacesGPU[space], 3, srcGPU);
-                    }
-                // If the option is not recognized
-                }else cout << "Option " << c << " not recognized, skipping..." << endl;
-            }
-
+            applyChannelPlanGPU(srcGPU, plan, min_percent, max_percent, stopRequested);
             srcGPU.download(src);
-            dstGPU.download(dst);
-            
         }
     #endif
     if(not CUDA){
-        // CPU Implementation
-        Mat dstSpaces[6][3];
-        // Now, according to parameters provided at CLI calling time, we must split and process the image
-        for (int nc=0; nc<num_convert; nc++){
-            char c = cChannel[nc];
-            int channel = numChannel(c);
-            int space = numSpace(c);
-            cout << "\tChannel[" << nc << "]: " << c << endl;
-
-            // If the option is recognized
-            if(!(space == -1)){
-                // Spaces HSV, hsl, Lab, YCX
-                if(space == 1 || space == 2 || space == 3 || space == 4 ){
-                    // Convert space
-                    cv::cvtColor(src,dst,transformation[space - 1][0]);
-                    // Split channels
-                    split (dst, dstSpaces[space]);
-                    // Stretch of selected channel
-                    imgChannelStretch(dstSpaces[space][channel], dstSpaces[space][channel], min_percent, max_percent);
-                    // Convert back to BGR space
-                    cv::cvtColor(dst,src,transformation[space - 1][1]);
-                    // Merge channels to dst
-                    merge (dstSpaces[space], 3, dst);
-                }
-                // Space BGR
-                else{
-                    // Split channels
-                    split (src, dstSpaces[space]);
-                    // Stretch of selected channel
-                    imgChannelStretch(dstSpaces[space][channel], dstSpaces[space][channel], min_percent, max_percent);
-                    // Merge channels to src
-                    merge (dstSpaces[space], 3, src);
-                }
-            // If the option is not recognized
-            }else cout << "Option " << c << " not recognized, skipping..." << endl;
-        }
+        // CPU Implementation: each step converts into its space, stretches all of its channels, and converts back
+        applyChannelPlan(src, plan, min_percent, max_percent, stopRequested);
     }
 
     //  End time measurement (Showing time results is optional)
@@ -260,13 +303,25 @@ int main(int argc, char *argv[]) {
         t = (double) getTickCount();
     }
 
-    namedWindow( dst_window, WINDOW_AUTOSIZE);
-    cout << "hS: showing resulting window" << endl;
-    imshow (dst_window, src);
+    if (stopRequested()) {
+        cout << "hS: stop requested, output not written" << endl;
+        status.update("stopped", true);
+        return 1;
+    }
+#ifndef HEADLESS
+    if (!headless) {
+        namedWindow( dst_window, WINDOW_AUTOSIZE);
+        cout << "hS: showing resulting window" << endl;
+        imshow (dst_window, src);
+    }
+#endif
     cout << "hS: saving to disk" << endl;
     // Saving output file in specified directory
     imwrite (OutputFile, src);
+    status.update("done", true);
 
-    waitKey(0);
+#ifndef HEADLESS
+    if (!headless) waitKey(0);
+#endif
 	return 0;
 }
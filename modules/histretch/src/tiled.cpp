@@ -0,0 +1,224 @@
+/********************************************************************/
+/* Project: uwimageproc								                */
+/* Module: 	histretch	- Histogram Stretching		                */
+/* File: 	tiled.cpp                                               */
+/* Created:		17/10/2026                                          */
+/* Description:
+    Tiled mode: TIFF/BigTIFF mosaics are stretched one tile (or strip) at a time, with a
+    pass accumulating the global histograms and a pass applying the stretch tables.
+ */
+/********************************************************************/
+
+#include <cstdio>
+
+#include "../include/tiled.h"
+
+#if USE_TIFF
+#include <tiffio.h>
+#endif
+
+bool tiledSupported() {
+#if USE_TIFF
+    return true;
+#else
+    return false;
+#endif
+}
+
+#if USE_TIFF
+// Blocks of a TIFF: tiles, or strips of full rows, numbered as libtiff does for interleaved samples
+struct BlockLayout {
+    uint32_t width, height;
+    uint32_t blockWidth, blockHeight;
+    bool tiled;
+
+    uint32_t across() const { return (width + blockWidth - 1) / blockWidth; }
+    uint32_t blocks() const { return across() * ((height + blockHeight - 1) / blockHeight); }
+
+    // area of the image covered by a block (edge tiles and the last strip are cropped)
+    Rect area(uint32_t block) const {
+        int x = (block % across()) * blockWidth;
+        int y = (block / across()) * blockHeight;
+        return Rect(x, y, std::min(blockWidth, width - x), std::min(blockHeight, height - y));
+    }
+};
+
+static TIFF *openInput(const string &input, BlockLayout &layout, uint16_t &compression) {
+    TIFF *tif = TIFFOpen(input.c_str(), "r");
+    if (!tif) return NULL;
+    uint16_t bits = 0, samples = 0, planar = PLANARCONFIG_CONTIG, photometric = 0;
+    TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &layout.width);
+    TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &layout.height);
+    TIFFGetFieldDefaulted(tif, TIFFTAG_BITSPERSAMPLE, &bits);
+    TIFFGetFieldDefaulted(tif, TIFFTAG_SAMPLESPERPIXEL, &samples);
+    TIFFGetFieldDefaulted(tif, TIFFTAG_PLANARCONFIG, &planar);
+    TIFFGetFieldDefaulted(tif, TIFFTAG_COMPRESSION, &compression);
+    TIFFGetField(tif, TIFFTAG_PHOTOMETRIC, &photometric);
+
+    // JPEG compressed YCbCr is decoded to RGB by libtiff itself; other YCbCr layouts come subsampled
+    bool rgb = (photometric == PHOTOMETRIC_RGB);
+    if (photometric == PHOTOMETRIC_YCBCR && compression == COMPRESSION_JPEG) {
+        TIFFSetField(tif, TIFFTAG_JPEGCOLORMODE, JPEGCOLORMODE_RGB);
+        rgb = true;
+    }
+    if (bits != 8 || samples != 3 || planar != PLANARCONFIG_CONTIG || !rgb) {
+        cerr << "Tiled mode requires an 8-bit RGB TIFF with interleaved samples: " << input << endl;
+        TIFFClose(tif);
+        return NULL;
+    }
+
+    layout.tiled = TIFFIsTiled(tif);
+    if (layout.tiled) {
+        TIFFGetField(tif, TIFFTAG_TILEWIDTH, &layout.blockWidth);
+        TIFFGetField(tif, TIFFTAG_TILELENGTH, &layout.blockHeight);
+    }
+    else {
+        layout.blockWidth = layout.width;
+        TIFFGetFieldDefaulted(tif, TIFFTAG_ROWSPERSTRIP, &layout.blockHeight);
+        layout.blockHeight = std::min(layout.blockHeight, layout.height);
+    }
+    if (layout.blockWidth == 0 || layout.blockHeight == 0
+        || (uint64_t) layout.blockWidth * layout.blockHeight * 3 > TILED_MAX_BLOCK) {
+        cerr << "Blocks of " << layout.blockWidth << " x " << layout.blockHeight << " pixels are too large for the"
+             << " tiled mode, convert the image to a tiled TIFF first (e.g. tiffcp -t): " << input << endl;
+        TIFFClose(tif);
+        return NULL;
+    }
+    return tif;
+}
+
+// output with the size, layout and compression of the input
+static TIFF *openOutput(const string &output, TIFF *in, const BlockLayout &layout, uint16_t compression) {
+    bool big = TIFFIsBigTIFF(in) || (uint64_t) layout.width * layout.height * 3 > TILED_BIGTIFF_SIZE;
+    TIFF *tif = TIFFOpen(output.c_str(), big ? "w8" : "w");
+    if (!tif) return NULL;
+    if (!TIFFIsCODECConfigured(compression)) compression = COMPRESSION_LZW;
+    TIFFSetField(tif, TIFFTAG_IMAGEWIDTH, layout.width);
+    TIFFSetField(tif, TIFFTAG_IMAGELENGTH, layout.height);
+    TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE, 8);
+    TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, 3);
+    TIFFSetField(tif, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+    TIFFSetField(tif, TIFFTAG_COMPRESSION, compression);
+    if (compression == COMPRESSION_JPEG) {
+        TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_YCBCR);
+        TIFFSetField(tif, TIFFTAG_JPEGQUALITY, TILED_JPEG_QUALITY);
+        TIFFSetField(tif, TIFFTAG_JPEGCOLORMODE, JPEGCOLORMODE_RGB);
+    }
+    else TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
+    if (layout.tiled) {
+        TIFFSetField(tif, TIFFTAG_TILEWIDTH, layout.blockWidth);
+        TIFFSetField(tif, TIFFTAG_TILELENGTH, layout.blockHeight);
+    }
+    else TIFFSetField(tif, TIFFTAG_ROWSPERSTRIP, layout.blockHeight);
+
+    uint16_t predictor, unit;
+    float xResolution, yResolution;
+    if (compression != COMPRESSION_JPEG && TIFFGetField(in, TIFFTAG_PREDICTOR, &predictor))
+        TIFFSetField(tif, TIFFTAG_PREDICTOR, predictor);
+    if (TIFFGetField(in, TIFFTAG_XRESOLUTION, &xResolution) && TIFFGetField(in, TIFFTAG_YRESOLUTION, &yResolution)) {
+        TIFFSetField(tif, TIFFTAG_XRESOLUTION, xResolution);
+        TIFFSetField(tif, TIFFTAG_YRESOLUTION, yResolution);
+        if (TIFFGetField(in, TIFFTAG_RESOLUTIONUNIT, &unit)) TIFFSetField(tif, TIFFTAG_RESOLUTIONUNIT, unit);
+    }
+    TIFFSetField(tif, TIFFTAG_SOFTWARE, "histretch");
+    return tif;
+}
+
+// reads a block into buffer (blockHeight x blockWidth, RGB), returns the part of it inside the image
+static bool readBlock(TIFF *tif, const BlockLayout &layout, uint32_t block, Mat &buffer, Mat &valid) {
+    tmsize_t size = (tmsize_t) buffer.total() * buffer.elemSize();
+    tmsize_t read = layout.tiled ? TIFFReadEncodedTile(tif, block, buffer.data, size)
+                                 : TIFFReadEncodedStrip(tif, block, buffer.data, size);
+    if (read < 0) return false;
+    Rect area = layout.area(block);
+    valid = buffer(Rect(0, 0, area.width, area.height));
+    return true;
+}
+
+// applies the first nSteps steps of a plan to a BGR block, with the tables computed for them
+static void applySteps(Mat &bgr, const vector<ChannelStep> &plan, const vector<Mat> &tables, size_t nSteps, Mat &converted) {
+    for (size_t i = 0; i < nSteps; i++) {
+        int space = plan[i].space;
+        if (space == 0) {
+            LUT(bgr, tables[i], bgr);
+            continue;
+        }
+        cvtColor(bgr, converted, spaceConversion(space));
+        LUT(converted, tables[i], converted);
+        cvtColor(converted, bgr, spaceConversion(space, true));
+    }
+}
+
+bool stretchTiled(const string &input, const string &output, const vector<ChannelStep> &plan,
+                  int lowerPercentile, int higherPercentile, StatusFile &status) {
+    BlockLayout layout;
+    uint16_t compression = COMPRESSION_NONE;
+    TIFF *in = openInput(input, layout, compression);
+    if (!in) return false;
+    cout << "Image:\t" << layout.width << " x " << layout.height << ", " << layout.blocks() << (layout.tiled ? " tiles" : " strips")
+         << " of " << layout.blockWidth << " x " << layout.blockHeight << endl;
+
+    // the only full size data is on disk: these buffers hold a single block
+    Mat buffer(layout.blockHeight, layout.blockWidth, CV_8UC3), valid, bgr, converted;
+    vector<Mat> tables(plan.size());
+    ChannelHistograms hist;
+    int nPasses = (int) plan.size() + 1;
+    status.set("passes", nPasses);
+    bool ok = true;
+
+    // histogram passes: one per step, over the image left by the previous steps
+    for (size_t k = 0; k < plan.size() && ok; k++) {
+        cout << "Pass " << k + 1 << "/" << nPasses << ": histograms of " << plan[k].channels << " in "
+             << spaceName(plan[k].space) << " space" << endl;
+        status.set("pass", (int) k + 1);
+        hist.clear();
+        for (uint32_t b = 0; b < layout.blocks() && ok; b++) {
+            if (stopRequested() || !readBlock(in, layout, b, buffer, valid)) ok = false;
+            else {
+                cvtColor(valid, bgr, COLOR_RGB2BGR);
+                applySteps(bgr, plan, tables, k, converted);
+                if (plan[k].space != 0) cvtColor(bgr, converted, spaceConversion(plan[k].space));
+                getHistograms(plan[k].space != 0 ? converted : bgr, hist, true);
+                status.set("blocks_done", (int) b + 1);
+                status.update("running");
+            }
+        }
+        if (ok) tables[k] = stretchTable(hist, lowerPercentile, higherPercentile, plan[k].channelMask);
+    }
+
+    // stretch pass: every block is written as it is read, tiles with their padding (libtiff writes whole tiles)
+    TIFF *out = ok ? openOutput(output, in, layout, compression) : NULL;
+    if (ok && out) {
+        cout << "Pass " << nPasses << "/" << nPasses << ": stretch" << endl;
+        status.set("pass", nPasses);
+        for (uint32_t b = 0; b < layout.blocks() && ok; b++) {
+            if (stopRequested() || !readBlock(in, layout, b, buffer, valid)) {
+                ok = false;
+                break;
+            }
+            Mat block = layout.tiled ? buffer : valid;
+            cvtColor(block, bgr, COLOR_RGB2BGR);
+            applySteps(bgr, plan, tables, plan.size(), converted);
+            cvtColor(bgr, block, COLOR_BGR2RGB);
+            tmsize_t size = (tmsize_t) block.total() * block.elemSize();
+            ok = (layout.tiled ? TIFFWriteEncodedTile(out, b, block.data, size)
+                               : TIFFWriteEncodedStrip(out, b, block.data, size)) >= 0;
+            status.set("blocks_done", (int) b + 1);
+            status.update("running");
+        }
+    }
+    else ok = false;
+    if (out) TIFFClose(out);
+    TIFFClose(in);
+    // a partial output would be taken as a valid (but truncated) mosaic
+    if (!ok) std::remove(output.c_str());
+    return ok;
+}
+
+#else
+bool stretchTiled(const string &input, const string &output, const vector<ChannelStep> &plan,
+                  int lowerPercentile, int higherPercentile, StatusFile &status) {
+    cerr << "histretch was built without libtiff, the tiled mode is not available" << endl;
+    return false;
+}
+#endif
@@ -0,0 +1,80 @@
+/**
+ * @file batch.h
+ * @brief Batch mode: processes every video found in a directory, with a pool of workers
+ * @version 1.0
+ * @date 17/10/2026
+ *
+ * Each worker takes the next pending video and runs the whole keyframe selection on it, with its own capture,
+ * pipeline and KeyframeSelector. Keyframes and report of each video are written with its own prefix
+ * (output prefix + path of the video under the searched directory), and a throughput summary for every file is written once all are done.
+ */
+#ifndef _BATCH_H_
+#define _BATCH_H_
+
+#include "videostrip.hpp"
+#include "exporter.h"
+#include "selector.h"
+
+#define BATCH_EXTENSIONS    "mpg mpeg tod mts m2ts mp4 avi mov mkv"     //< Video files searched in batch mode
+#define BATCH_SUMMARY_FILE  "videostrip_batch.txt"                      //< Summary written after the output prefix
+
+/// Parameters shared by all the videos of the batch
+struct BatchSettings {
+    string prefix;          // output prefix. Each video writes into prefix + <video name> + "_" (see videoNames)
+    int nWorkers;           // videos processed at the same time
+    int exportWorkers;      // writer threads of the shared exporter, used to size the frame rings
+    int timeSkip;           // seconds skipped at the start of every video
+    bool useIndex;          // seek with the frame index of each video (see FrameIndex), built on first use
+    bool lumaOnly;          // analyse the luma plane only (see PipelineOptions::lumaOnly)
+    SelectorSettings selection;     // keyframe selection parameters. The resize factor is computed per video
+};
+
+/// Outcome of a single video
+struct BatchResult {
+    string input;           // video file
+    string prefix;          // prefix of its keyframes and report
+    bool ok;                // the video could be opened and read
+    int frames;             // frames covered, from the first to the last one read
+    int analysed;           // frames actually decoded and analysed (less than frames with adaptive sampling)
+    int keyframes;          // exported keyframes
+    double seconds;         // wall-clock processing time
+};
+
+/**
+ * @brief Lists the video files (see BATCH_EXTENSIONS, case insensitive) under a directory, recursively
+ * @param dir   Directory to search
+ * @retval Sorted list of video files
+ */
+vector<string> findVideos(const string &dir);
+
+/**
+ * @brief Output name of every video of a batch, unique within the batch
+ * @param dir       Directory searched by findVideos
+ * @param videos    Videos found under dir
+ * @retval Path of each video relative to dir, without extension and with '/' mapped to '_' (e.g. dive01_MOV001 for
+ *         dir/dive01/MOV001.TOD). Videos that differ only by extension keep it (dive01_MOV001_tod), and any name
+ *         still repeated gets the position of the video in the list
+ */
+vector<string> videoNames(const string &dir, const vector<string> &videos);
+
+/**
+ * @brief Runs the keyframe selection on a single video
+ * @param input     Video file
+ * @param prefix    Prefix of the exported keyframes and of the report file
+ * @param settings  Batch parameters
+ * @param exporter  Keyframe exporter, shared by all the workers
+ * @retval Processing statistics of the video
+ */
+BatchResult processVideo(const string &input, const string &prefix, const BatchSettings &settings, KeyframeExporter &exporter);
+
+/**
+ * @brief Processes every video in dir on a pool of settings.nWorkers workers, and writes the throughput summary
+ * @param dir       Directory with the input videos
+ * @param settings  Batch parameters
+ * @param exporter  Keyframe exporter, shared by all the workers
+ * @param status    Status file, updated every time a video is completed
+ * @retval int Number of videos that could not be processed, or -1 if no video was found
+ */
+int processBatch(const string &dir, const BatchSettings &settings, KeyframeExporter &exporter, StatusFile &status);
+
+#endif // _BATCH_H_
@@ -0,0 +1,54 @@
+/**
+ * @file checkpoint.h
+ * @brief Periodic checkpoints of a videostrip run, so an interrupted run can be resumed where it stopped
+ * @version 1.0
+ * @date 17/10/2026
+ *
+ * A checkpoint holds everything the keyframe selection needs to continue: the next frame to analyse, the
+ * number of the next exported keyframe, the length of the report up to the last keyframe, and the current
+ * keyframe itself (index, grayscale resized image and features). It is written next to the report, as
+ * <output>videostrip_checkpoint.yml.gz, only between refinement windows and once every exported keyframe
+ * was written, so resuming never repeats nor loses a keyframe.
+ */
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+
+#include "videostrip.hpp"
+
+#define CHECKPOINT_PERIOD   60      //< Default time between checkpoints, in seconds
+#define CHECKPOINT_VERSION  1       //< Format version, checkpoints of other versions are not resumed
+
+/// State of a single mode run, enough to resume it
+struct Checkpoint {
+    string input;           // input video file
+    int videoFrames;        // frame count of the video, checked when resuming
+    Size frameSize;         // full resolution size of the video, checked when resuming
+    string featureType;     // feature backend of the keyframe descriptors, checked when resuming
+    int position;           // next frame to analyse
+    int outputCounter;      // number of the next exported keyframe
+    double reportOffset;    // length of the report (bytes) after the last keyframe row
+    int keyframeIndex;      // frame number of the current keyframe
+    Mat grey;               // grayscale resized image of the current keyframe
+    vector<KeyPoint> keypoints;     // keyframe features (empty when tracking with optical flow)
+    Mat descriptors;
+
+    Checkpoint() : videoFrames(0), position(0), outputCounter(0), reportOffset(0), keyframeIndex(-1) {}
+};
+
+/// Checkpoint file written for a given output prefix
+string checkpointFileName(const string &prefix);
+
+/**
+ * @brief Writes a checkpoint. It is written to a temporary file first and then renamed, so a run killed
+ * while writing keeps the previous checkpoint
+ * @retval true when the checkpoint was written
+ */
+bool saveCheckpoint(const string &filename, const Checkpoint &checkpoint);
+
+/**
+ * @brief Reads a checkpoint written by saveCheckpoint()
+ * @retval false if the file is missing, unreadable or of another CHECKPOINT_VERSION
+ */
+bool loadCheckpoint(const string &filename, Checkpoint &checkpoint);
+
+#endif // _CHECKPOINT_H_
@@ -0,0 +1,131 @@
+/**
+ * @file exporter.h
+ * @brief Asynchronous keyframe exporter with a pool of writer threads and pluggable image encoders
+ * @version 1.0
+ * @date 17/10/2026
+ */
+#ifndef _EXPORTER_H_
+#define _EXPORTER_H_
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "videostrip.hpp"
+#include "../../common/boundedqueue.h"
+
+#define DEFAULT_EXPORT_FORMAT   "jpg"   //< Output image format for exported keyframes
+#define DEFAULT_JPEG_QUALITY    95      //< JPEG quality [0-100] (same as OpenCV default)
+#define DEFAULT_PNG_COMPRESSION 1       //< PNG compression level [0-9]. Low values trade size for speed
+#define DEFAULT_EXPORT_WORKERS  2       //< Number of threads encoding and writing keyframes
+
+/**
+ * @brief Base class for keyframe encoders. Each derived class writes a given image format
+ */
+class FrameEncoder {
+public:
+    virtual ~FrameEncoder() {}
+    /// File extension (including the dot) appended to the output file name
+    virtual string extension() const = 0;
+    /// Encodes img and writes it into filename. Returns false on failure
+    virtual bool write(const string &filename, const Mat &img) const = 0;
+};
+
+/// JPEG encoder with selectable quality [0-100]
+class JpegEncoder : public FrameEncoder {
+public:
+    explicit JpegEncoder(int quality = DEFAULT_JPEG_QUALITY);
+    string extension() const { return ".jpg"; }
+    bool write(const string &filename, const Mat &img) const;
+private:
+    vector<int> params;
+};
+
+/// Lossless PNG encoder with selectable compression level [0-9]
+class PngEncoder : public FrameEncoder {
+public:
+    explicit PngEncoder(int compression = DEFAULT_PNG_COMPRESSION);
+    string extension() const { return ".png"; }
+    bool write(const string &filename, const Mat &img) const;
+private:
+    vector<int> params;
+};
+
+/// Uncompressed binary PPM (P6), the cheapest option when frames will be processed later anyway
+class PpmEncoder : public FrameEncoder {
+public:
+    PpmEncoder();
+    string extension() const { return ".ppm"; }
+    bool write(const string &filename, const Mat &img) const;
+private:
+    vector<int> params;
+};
+
+/**
+ * @brief Creates the encoder for a given format name
+ * @param format    Output format: "jpg" (or "jpeg"), "png" or "ppm"
+ * @param quality   JPEG quality or PNG compression level. Negative value selects the default of the encoder
+ * @retval Ptr<FrameEncoder> Pointer to the encoder, empty if the format is not supported
+ */
+Ptr<FrameEncoder> createEncoder(const string &format, int quality = -1);
+
+/**
+ * @brief Writes keyframes to disk from a pool of worker threads
+ *
+ * Frames are queued by write() and encoded in the background, so the selection loop only blocks when
+ * queueSize frames are already waiting. Frames are shared (not copied), so the caller must not modify
+ * the pixels of a submitted frame; an owner handle (e.g. its FrameSlot) can be passed along to keep the
+ * buffer from being recycled before it is written. close() must be called to guarantee every frame
+ * reached the disk.
+ */
+class KeyframeExporter {
+public:
+    /**
+     * @param encoder   Encoder used for every exported frame
+     * @param nWorkers  Number of writer threads
+     * @param queueSize Maximum number of frames waiting to be written
+     */
+    KeyframeExporter(Ptr<FrameEncoder> encoder, int nWorkers, int queueSize);
+    ~KeyframeExporter();
+
+    /// Output file extension given by the encoder, e.g. ".jpg"
+    string extension() const { return encoder->extension(); }
+
+    /**
+     * @brief Queues img to be written as basename + extension()
+     * @param basename  Output file name, without extension
+     * @param img       Frame to be written
+     * @param owner     Optional handle kept alive until the frame has been written
+     * @retval string The full output file name
+     */
+    string write(const string &basename, const Mat &img, const std::shared_ptr<void> &owner = std::shared_ptr<void>());
+
+    /// Waits until every queued frame has been written, the workers keep running
+    void flush();
+
+    /// Flushes the pending frames and terminates the workers. Safe to call more than once
+    void close();
+
+    /// Number of frames that could not be written so far
+    int failures();
+
+private:
+    struct Job {
+        string filename;
+        Mat img;
+        std::shared_ptr<void> owner;
+    };
+
+    void writeLoop();
+
+    Ptr<FrameEncoder> encoder;
+    BoundedQueue<Job> jobs;
+    vector<std::thread> workers;
+
+    std::mutex mtx;
+    std::condition_variable doneCond;
+    int pending;    // frames queued or being written
+    int failed;
+};
+
+#endif // _EXPORTER_H_
@@ -0,0 +1,76 @@
+/**
+ * @file features.h
+ * @brief Selectable feature detector/descriptor and matcher used for the overlap estimation
+ * @version 1.0
+ * @date 17/10/2026
+ */
+#ifndef _FEATURES_H_
+#define _FEATURES_H_
+
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv_modules.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/features2d.hpp>
+// SURF is part of the nonfree contrib module, only available if OpenCV was built with it
+#ifdef HAVE_OPENCV_XFEATURES2D
+    #include <opencv2/xfeatures2d.hpp>
+#endif
+
+#ifdef HAVE_OPENCV_XFEATURES2D
+    #define DEFAULT_FEATURES "SURF"    //< Feature backend used when none is given
+#else
+    #define DEFAULT_FEATURES "ORB"
+#endif
+#define SURF_MIN_HESSIAN    400     //< Hessian threshold for SURF keypoints
+#define ORB_MAX_FEATURES    1000    //< Maximum number of ORB keypoints per frame
+
+/**
+ * @brief Feature detector, descriptor extractor and matching strategy, bundled together
+ *
+ * The detector and the matcher are created once and reused for every frame. Float descriptors (SURF) are
+ * matched with L2 distance, while binary descriptors (ORB, AKAZE, BRISK) use Hamming distance, which is
+ * much cheaper to compute. OpenCV detectors are not guaranteed to be thread-safe, so each thread should
+ * create its own instance.
+ *
+ * @code{.cpp}
+    cv::Ptr<FeatureBackend> features = FeatureBackend::create("ORB");
+    features->detectAndCompute(grey, keypoints, descriptors);
+    features->knnMatch(descriptors, kframe.descriptors, matches);
+ * @endcode
+ */
+class FeatureBackend {
+public:
+    /**
+     * @brief Creates the backend for a given feature type
+     * @param name  Feature type: SURF, ORB, AKAZE or BRISK (case insensitive)
+     * @retval cv::Ptr<FeatureBackend> The backend, or an empty pointer if the type is unknown or unavailable
+     */
+    static cv::Ptr<FeatureBackend> create(const std::string &name);
+
+    /// List of the feature types available in this build, e.g. "SURF, ORB, AKAZE, BRISK"
+    static std::string available();
+
+    /// Detects keypoints on a grayscale image and computes their descriptors
+    void detectAndCompute(const cv::Mat &img_grey, std::vector<cv::KeyPoint> &keypoints, cv::Mat &descriptors);
+
+    /// For each query descriptor, finds the two closest train descriptors (as required by the ratio test)
+    void knnMatch(const cv::Mat &query, const cv::Mat &train, std::vector<std::vector<cv::DMatch> > &matches);
+
+    /// Name of the feature type, in upper case
+    std::string name() const { return type; }
+
+    /// True for binary descriptors, matched with Hamming distance
+    bool isBinary() const { return normType == cv::NORM_HAMMING || normType == cv::NORM_HAMMING2; }
+
+private:
+    FeatureBackend(const std::string &type, cv::Ptr<cv::Feature2D> detector);
+
+    std::string type;
+    int normType;
+    cv::Ptr<cv::Feature2D> detector;
+    cv::Ptr<cv::DescriptorMatcher> matcher;
+};
+
+#endif // _FEATURES_H_
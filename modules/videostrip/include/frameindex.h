@@ -0,0 +1,77 @@
+/**
+ * @file frameindex.h
+ * @brief Per-video seek index, cached in a sidecar file next to the video
+ * @version 1.0
+ * @date 17/10/2026
+ *
+ * Seeking by time (CAP_PROP_POS_MSEC) or by frame (CAP_PROP_POS_FRAMES) relies on the timestamps of the stream,
+ * which are often broken in MPG/TOD files: the backend lands on the wrong frame, or decodes linearly from the
+ * start. The index is built once, with a single pass of grab() over the video, recording the timestamp of every
+ * frame. Every INDEX_ANCHOR_SPACING frames, a seek is then checked against those timestamps: the anchors where
+ * the backend lands on the right frame are kept. Later seeks go to the closest anchor before the target frame
+ * and grab forward the few remaining frames, so they are exact and take a bounded time.
+ *
+ * The index is written as <video>.vsidx, with the size and modification time of the video, so it is rebuilt
+ * when the video changes.
+ */
+#ifndef _FRAMEINDEX_H_
+#define _FRAMEINDEX_H_
+
+#include "videostrip.hpp"
+
+#define INDEX_ANCHOR_SPACING    250     //< Frames between two candidate seek anchors, the most grabbed after a seek
+#define INDEX_VERSION           1       //< Sidecar format version, sidecars of other versions are rebuilt
+
+/**
+ * @brief Timestamps of every frame of a video, and the frames where seeking is known to be exact
+ */
+class FrameIndex {
+public:
+    FrameIndex();
+
+    /**
+     * @brief Loads the sidecar of a video, or builds the index (and writes the sidecar) if it is missing or stale
+     * @param video     Video file
+     * @param verbose   Report on the console when the index is built, and when it could not be written
+     * @retval false if the video could not be read
+     */
+    bool open(const string &video, bool verbose = true);
+
+    /// Loads the sidecar of a video. Returns false if it is missing, of another version, or the video changed
+    bool load(const string &video);
+
+    /// Builds the index with a full pass over the video
+    bool build(const string &video);
+
+    /// Writes the sidecar of the video the index was built for
+    bool save() const;
+
+    bool empty() const { return timestamps.empty(); }
+
+    /// Number of frames of the video (as counted while building the index, not as reported by the container)
+    int frames() const { return (int) timestamps.size(); }
+
+    /// Number of verified seek anchors, including the first frame
+    int nAnchors() const { return (int) anchors.size(); }
+
+    /// First frame shown at least msec milliseconds after the first frame of the video
+    int frameAt(double msec) const;
+
+    /**
+     * @brief Positions a capture of the video so that the next grab()/read() returns the given frame
+     * @retval false if the capture could not be positioned
+     */
+    bool seek(VideoCapture &capture, int frame) const;
+
+private:
+    string video;
+    int64_t fileSize;           // size and modification time of the video the index was built for
+    int64_t fileTime;
+    vector<double> timestamps;  // CAP_PROP_POS_MSEC of every frame
+    vector<int> anchors;        // frames where a CAP_PROP_POS_FRAMES seek lands exactly, sorted. Always starts with 0
+};
+
+/// Sidecar file of a video
+string indexFileName(const string &video);
+
+#endif // _FRAMEINDEX_H_
@@ -0,0 +1,78 @@
+/**
+ * @file framering.h
+ * @brief Preallocated pool of frame buffers shared by the decode, analysis and export stages
+ * @version 1.0
+ * @date 17/10/2026
+ */
+#ifndef _FRAMERING_H_
+#define _FRAMERING_H_
+
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+#include <opencv2/core.hpp>
+
+/**
+ * @brief Buffers for a single decoded frame. They keep their allocation when the slot is reused
+ *
+ * Besides the decoded frame, the slot caches the images derived from it (see FramePacket), so each one is
+ * computed at most once per frame, by whichever stage needs it first. The flags tell which ones are valid.
+ */
+struct FrameSlot {
+    int id;                         // position of the slot inside the ring (-1 for standalone frames)
+    cv::Mat img;                    // full resolution frame, as decoded (BGR, or raw YUV planes in luma mode)
+    cv::Mat bgr;                    // full resolution BGR frame, converted from raw YUV planes for export
+    cv::Mat res_img;                // resized frame used for analysis
+    cv::Mat grey;                   // grayscale version of res_img
+    std::vector<cv::Mat> pyramid;   // optical flow pyramid of grey (see cv::buildOpticalFlowPyramid)
+    bool hasResized, hasGrey, hasBgr;
+    int pyramidLevels;              // levels of the cached pyramid, -1 if not built
+
+    FrameSlot() : id(-1), hasResized(false), hasGrey(false), hasBgr(false), pyramidLevels(-1) {}
+
+    /// Marks the derived images as outdated, once a new frame has been decoded into img
+    void invalidate() { hasResized = hasGrey = hasBgr = false; pyramidLevels = -1; }
+};
+
+/**
+ * @brief Fixed set of frame slots, allocated once and recycled for the whole video
+ *
+ * acquire() hands out a free slot wrapped in a shared pointer. The slot goes back to the ring when the
+ * last copy of that pointer is destroyed, so every stage that still needs the pixels (selection window,
+ * current keyframe, exporter) just keeps a copy of the handle, and no frame is ever deep copied.
+ * When every slot is in use, acquire() blocks, which also throttles the decoder.
+ */
+class FrameRing {
+public:
+    /**
+     * @param nSlots    Number of frames in the ring (search window plus frames in flight)
+     * @param frameSize Size of the full resolution frames, used to preallocate the buffers
+     * @param type      OpenCV type of the frames (usually CV_8UC3)
+     */
+    FrameRing(int nSlots, cv::Size frameSize, int type);
+
+    /**
+     * @brief Takes a free slot, waiting for one to be released if needed
+     * @retval Handle to the slot, or an empty pointer if the ring was closed
+     */
+    std::shared_ptr<FrameSlot> acquire();
+
+    /// Wakes up any thread waiting in acquire(). Slots already handed out remain valid
+    void close();
+
+    /// Total number of slots
+    int size() const { return (int) slots.size(); }
+
+private:
+    void release(FrameSlot *slot);
+
+    std::vector<FrameSlot> slots;
+    std::vector<int> freeSlots;
+    std::mutex mtx;
+    std::condition_variable freeCond;
+    bool closed;
+};
+
+#endif // _FRAMERING_H_
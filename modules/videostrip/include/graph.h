@@ -0,0 +1,134 @@
+/**
+ * @file graph.h
+ * @brief Keyframe features and match graph, written as a binary sidecar for the mosaicking and SfM stages
+ * @version 1.0
+ * @date 17/10/2026
+ *
+ * videostrip already extracts the features of every keyframe to estimate the overlap. With --graph, the
+ * keypoints and descriptors of each exported keyframe are written to <output>videostrip_graph.bin, together
+ * with the homography, overlap and inliers between every keyframe and the GRAPH_WINDOW keyframes before it.
+ * Keyframes further apart along a transect do not overlap, so the next stage can skip both the feature
+ * extraction and the search of overlapping pairs.
+ *
+ * The file is little endian, with fixed size records, and every section starts at a multiple of 8 bytes, so
+ * it can be memory mapped and used in place through the structures below:
+ *
+ *      GraphHeader                                 at 0
+ *      descriptors     nKeypoints x descriptorSize at descriptorOffset (rows of the OpenCV descriptor matrices)
+ *      GraphKeyframe   x nKeyframes                at keyframeOffset
+ *      GraphKeypoint   x nKeypoints                at keypointOffset
+ *      GraphEdge       x nEdges                    at edgeOffset
+ *
+ * Keypoints and homographies are given at the analysis resolution (TARGET_WIDTH wide). Divide by the header
+ * scale to get full resolution coordinates.
+ */
+#ifndef _GRAPH_H_
+#define _GRAPH_H_
+
+#include <deque>
+#include <stdint.h>
+
+#include "videostrip.hpp"
+
+#define GRAPH_VERSION   1       //< Format version, stored in the header
+#define GRAPH_WINDOW    4       //< Previous keyframes every new keyframe is matched against
+
+/// File header
+struct GraphHeader {
+    char magic[8];              // "VSGRAPH" and a null character
+    uint32_t version;           // GRAPH_VERSION
+    uint32_t descriptorType;    // OpenCV type of the descriptor rows: CV_32F (SURF) or CV_8U (binary features)
+    uint32_t descriptorSize;    // bytes per descriptor
+    uint32_t nKeyframes;
+    uint32_t nKeypoints;        // over all the keyframes
+    uint32_t nEdges;
+    float scale;                // analysis resolution over video resolution
+    uint32_t width, height;     // analysis resolution
+    char features[12];          // feature type, e.g. "SURF", null terminated
+    uint64_t descriptorOffset;
+    uint64_t keyframeOffset;
+    uint64_t keypointOffset;
+    uint64_t edgeOffset;
+};
+
+/// Exported keyframe. Its keypoints and descriptors are the range [firstKeypoint, firstKeypoint + nKeypoints)
+struct GraphKeyframe {
+    int32_t id;                 // keyframe number, as in the report and the exported file name
+    int32_t frame;              // frame number in the video
+    uint32_t firstKeypoint;
+    uint32_t nKeypoints;
+};
+
+/// Keypoint, as cv::KeyPoint (class_id is not kept)
+struct GraphKeypoint {
+    float x, y;
+    float size;
+    float angle;
+    float response;
+    int32_t octave;
+};
+
+/// Match between two keyframes
+struct GraphEdge {
+    int32_t from;               // keyframe id (the most recent of the two)
+    int32_t to;                 // keyframe id of the earlier keyframe
+    float overlap;              // overlap of both keyframes (see overlapArea)
+    int32_t inliers;            // RANSAC inliers of the homography
+    double H[9];                // homography mapping keyframe "from" into keyframe "to", row major
+};
+
+/**
+ * @brief Writes the features of the exported keyframes and their match graph, as keyframes are selected
+ *
+ * Descriptors are streamed to the file as keyframes arrive; keypoints, keyframe records and edges are kept
+ * in memory (a few tens of bytes each) and written by close(), which also completes the header.
+ */
+class KeyframeGraph {
+public:
+    /**
+     * @param filename      Output file
+     * @param featureType   Feature backend, used to match the keyframes and to detect them when they come without features
+     * @param scale         Analysis resolution over video resolution (resize factor of the frames)
+     */
+    KeyframeGraph(const string &filename, const string &featureType, float scale);
+    ~KeyframeGraph();
+
+    /// False if the file could not be created or the feature type is not available
+    bool valid() const { return file.is_open() && !features.empty(); }
+
+    /**
+     * @brief Adds an exported keyframe, and matches it against the previous GRAPH_WINDOW keyframes
+     * @param id            Keyframe number
+     * @param frame         Frame number in the video
+     * @param grey          Grayscale frame at the analysis resolution
+     * @param keypoints     Its keypoints, if already extracted (empty: detected here)
+     * @param descriptors   Their descriptors
+     */
+    void add(int id, int frame, const Mat &grey, const vector<KeyPoint> &keypoints, const Mat &descriptors);
+
+    /// Writes the keyframes, keypoints and edges, and the final header. Safe to call more than once
+    bool close();
+
+    int keyframes() const { return (int) records.size(); }
+    int edges() const { return (int) links.size(); }
+
+private:
+    struct Node {
+        int id;
+        Size size;
+        vector<KeyPoint> keypoints;
+        Mat descriptors;
+    };
+
+    void pad();
+
+    ofstream file;
+    Ptr<FeatureBackend> features;
+    GraphHeader header;
+    std::deque<Node> recent;            // last GRAPH_WINDOW keyframes, matched against the next one
+    vector<GraphKeyframe> records;
+    vector<GraphKeypoint> points;
+    vector<GraphEdge> links;
+};
+
+#endif // _GRAPH_H_
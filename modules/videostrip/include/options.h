@@ -19,8 +19,25 @@ args::HelpFlag 	argHelp(argParser, "help", "Display this help menu", {'h', "help
 args::ValueFlag	<int> 		argWindowSize(argParser, "window size", "Size of the search window for the best frame", {'k', "windowSize"});
 args::ValueFlag	<int> 		argTimeSkip(argParser, "time skip", "Time (in seconds) skipped from the start of video", {'s', "timeSkip"});
 args::ValueFlag	<double> 	argOverlap(argParser, "overlap", "Desired maximum overlap among frames", {'p',"minOverlap"});
-args::Positional<std::string> 	argInput(argParser, "input", "Input file name");
-args::Positional<std::string> 	argOutput(argParser, "output", "Prefix for output JPG image files");
+args::ValueFlag	<int> 		argThreads(argParser, "threads", "Number of analysis worker threads (default: number of cores - 1)", {'t', "threads"});
+args::ValueFlag	<std::string> 	argFeatures(argParser, "features", "Feature type used for overlap estimation: SURF, ORB, AKAZE or BRISK (default: SURF if available)", {'d', "features"});
+args::ValueFlag	<std::string> 	argEstimator(argParser, "estimator", "Overlap estimator: 'features' (match descriptors on every frame) or 'flow' (track keyframe corners with optical flow)", {'e', "estimator"});
+args::Flag			argAdaptive(argParser, "adaptive", "Predict the overlap decay and skip (grab without decoding) frames far from the minOverlap threshold", {'a', "adaptive"});
+args::Flag			argLuma(argParser, "luma", "Decode and analyse the luma plane only (CAP_PROP_CONVERT_RGB disabled). Colour is recovered for exported frames", {'y', "luma"});
+args::ValueFlag	<int> 		argSegments(argParser, "segments", "Split the video in N time segments, processed in parallel", {'n', "segments"});
+args::ValueFlag	<std::string> 	argBatch(argParser, "dir", "Batch mode: process every video in <dir>, each one written with its own prefix", {'b', "batch"});
+args::Flag			argHeadless(argParser, "headless", "Unattended run: the keyboard is not polled, stop with SIGINT/SIGTERM (always on in HEADLESS builds)", {"headless"});
+args::ValueFlag	<std::string> 	argStatus(argParser, "file", "Write the progress of the run to <file>, as a JSON object", {"status"});
+args::Flag			argMetrics(argParser, "metrics", "Write the latency percentiles of every stage to <output>videostrip_metrics.json/.csv", {"metrics"});
+args::Flag			argGraph(argParser, "graph", "Write the features of the exported keyframes and the homographies between neighbouring keyframes to <output>videostrip_graph.bin", {"graph"});
+args::Flag			argNoIndex(argParser, "no-index", "Seek with the video backend (CAP_PROP_POS_MSEC/POS_FRAMES) instead of the frame index cached in <input>.vsidx", {"no-index"});
+args::ValueFlag	<double> 	argCheckpoint(argParser, "seconds", "Time between checkpoints of the run, written to <output>videostrip_checkpoint.yml.gz (default: 60, 0 disables them)", {"checkpoint"});
+args::Flag			argResume(argParser, "resume", "Resume an interrupted run from its last checkpoint, with the same input and output", {"resume"});
+args::ValueFlag	<std::string> 	argFormat(argParser, "format", "Output image format for exported frames: jpg, png or ppm (default: jpg)", {'f', "format"});
+args::ValueFlag	<int> 		argQuality(argParser, "quality", "JPEG quality [0-100] or PNG compression level [0-9]", {'q', "quality"});
+args::ValueFlag	<int> 		argWriters(argParser, "writers", "Number of threads writing exported frames", {'w', "writers"});
+args::Positional<std::string> 	argInput(argParser, "input", "Input file name (not used in batch mode)");
+args::Positional<std::string> 	argOutput(argParser, "output", "Prefix for output image files");
 args::ValueFlag <bool>		argReport(argParser, "report", "Generate report file containing detailed information for each exported frame", {'r', "--report"});
 
 #endif
@@ -0,0 +1,225 @@
+/**
+ * @file pipeline.h
+ * @brief Staged decode / analysis / export pipeline for videostrip
+ * @version 1.0
+ * @date 17/10/2026
+ *
+ * Frames are decoded by a single thread, analysed (resize, features, blur) by a pool of workers and
+ * handed back to the caller strictly in video order, so the keyframe selection logic stays sequential
+ * and produces the same decisions as the single threaded loop. Exported keyframes are written to disk
+ * by the KeyframeExporter (see exporter.h). All stages are connected through bounded queues, keeping
+ * memory usage fixed.
+ */
+#ifndef _PIPELINE_H_
+#define _PIPELINE_H_
+
+#include <map>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "videostrip.hpp"
+#include "../../common/boundedqueue.h"
+
+class FrameIndex;
+
+#define RECOVERY_MAX_GRAB   30  //< Frames read sequentially to reach the next keyframe, instead of seeking (ColourRecovery)
+
+/// Layout of a decoded frame. Anything but FRAME_BGR comes from a capture with CAP_PROP_CONVERT_RGB disabled
+enum FrameFormat {
+    FRAME_BGR,      // interleaved BGR, the default output of VideoCapture
+    FRAME_LUMA,     // luma plane only: the backend does not deliver the chroma planes
+    FRAME_I420,     // planar YUV 4:2:0, the luma plane followed by both chroma planes (1.5 x rows)
+    FRAME_YUYV      // packed YUV 4:2:2, two channels
+};
+
+/**
+ * @brief Guesses the layout of a frame returned by VideoCapture::read, from its shape
+ * @param raw       Decoded frame
+ * @param frameSize Size of the video frames, as reported by the capture
+ */
+FrameFormat frameFormat(const Mat &raw, Size frameSize);
+
+/**
+ * @brief Decoded frame travelling through the pipeline, together with the results of the analysis stage
+ *
+ * The resized, grayscale and pyramid representations are computed on first use and cached in the slot, so
+ * every copy of the packet (analysis worker, selector, tracker, keyframe) shares them and each one is computed
+ * at most once per frame. A frame is only handled by one stage at a time, so the cache needs no locking.
+ */
+struct FramePacket {
+    int index;                  // absolute frame number in the input video
+    std::shared_ptr<FrameSlot> slot;    // ring slot owning the frame buffers, and the cache of derived images
+    Mat img;                    // full resolution frame, as decoded (slot->img)
+    FrameFormat format;         // layout of img
+    float scale;                // resize factor from img to the analysis size
+    vector<KeyPoint> keypoints; // keypoints of grey()
+    Mat descriptors;            // descriptors of grey()
+    float blur;                 // calcBlur(grey())
+
+    /// Frame resized by scale. BGR, or only its luma plane when img holds raw YUV planes
+    const Mat &resized() const;
+
+    /// Grayscale version of resized()
+    const Mat &grey() const;
+
+    /**
+     * @brief Optical flow pyramid of grey(), as built by buildOpticalFlowPyramid
+     * @param winSize   Search window of the Lucas-Kanade tracker that will use it. Must not change among calls
+     * @param maxLevel  Pyramid levels (0-based)
+     */
+    const vector<Mat> &pyramid(Size winSize, int maxLevel) const;
+
+    /// Full resolution BGR frame, converted once from the YUV planes. Empty for FRAME_LUMA (see ColourRecovery)
+    const Mat &bgr() const;
+};
+
+/**
+ * @brief Wraps a frame that does not come from a FrameRing into a packet, with its own cache of derived images
+ * @param frame     Full resolution frame. It is referenced, not copied
+ * @param index     Frame number in the video
+ * @param scale     Resize factor to the analysis size
+ */
+FramePacket makePacket(const Mat &frame, int index, float scale);
+
+/// Settings of the analysis stage
+struct PipelineOptions {
+    int nWorkers;           // number of analysis threads
+    int queueSize;          // capacity of the decode queue and of the reorder buffer
+    float resizeFactor;     // resize from the original frame size to the analysis size (TARGET_WIDTH)
+    string featureType;     // feature backend used by the workers (see FeatureBackend::create)
+    bool detectFeatures;    // extract keypoints and descriptors for every frame. Not needed when tracking with optical flow
+    bool lumaOnly;          // ask the capture for raw YUV frames, so the analysis runs on the luma plane alone
+
+    PipelineOptions() :
+        nWorkers(1), queueSize(DEFAULT_QUEUE_SIZE), resizeFactor(1.0), featureType(DEFAULT_FEATURES),
+        detectFeatures(true), lumaOnly(false) {}
+};
+
+/**
+ * @brief Runs decoding and per-frame analysis in background threads
+ *
+ * The analysis of each frame is independent of the current keyframe, so it can run concurrently for
+ * several frames. Only the matching against the keyframe (which depends on previous decisions) is left
+ * to the caller, that consumes the packets in order through next().
+ */
+class FramePipeline {
+public:
+    /**
+     * @param capture       Opened video source, already positioned at the first frame to be processed
+     * @param ring          Frame buffers used by the decoder. Its size bounds the number of frames in flight
+     * @param options       Number of workers, queue size and per-frame analysis to be done
+     */
+    FramePipeline(VideoCapture &capture, FrameRing &ring, const PipelineOptions &options);
+    ~FramePipeline();
+
+    /**
+     * @brief Launches the decoder and the analysis workers
+     * @param first     Index of the frame the capture returns next. Negative: the position reported by the capture,
+     *                  which is only reliable for streams with sane timestamps (see FrameIndex)
+     */
+    void start(int first = -1);
+
+    /**
+     * @brief Retrieves the next analysed frame, in video order
+     * @retval false when the end of the video has been reached (or the pipeline was stopped)
+     */
+    bool next(FramePacket &packet);
+
+    /**
+     * @brief Skips every frame before the given index. Frames not decoded yet are only grabbed (no retrieve
+     * nor colour conversion), while frames already decoded or being analysed are dropped
+     * @param index     Index of the next frame to be handed by next()
+     */
+    void skipTo(int index);
+
+    /// Number of frames skipped with grab(), without being decoded
+    int grabbed() const { return nGrabbed; }
+
+    /// Whether the capture accepted to deliver raw YUV frames (see PipelineOptions::lumaOnly)
+    bool rawFrames() const { return raw; }
+
+    /// Aborts every stage and waits for the threads to finish. Safe to call more than once
+    void stop();
+
+private:
+    void decodeLoop(int index);
+    void analysisLoop();
+
+    VideoCapture &capture;
+    FrameRing &ring;
+    PipelineOptions options;
+    int nWorkers;
+    int capacity;
+    bool raw;
+    Size frameSize;
+
+    BoundedQueue<FramePacket> decoded;      // decoder -> analysis workers
+    std::map<int, FramePacket> analysed;    // reorder buffer: analysis workers -> caller
+    std::mutex mtx;
+    std::condition_variable readyCond, spaceCond;
+    int nextIndex;                          // index of the next packet to be handed to the caller
+    std::atomic<int> skipIndex;             // frames before this one are not decoded nor analysed
+    std::atomic<int> nGrabbed;
+    int activeWorkers;
+    bool stopped;
+
+    std::thread decoder;
+    vector<std::thread> workers;
+};
+
+/**
+ * @brief Provides the colour version of the frames to be exported, when the analysis only decoded their luma
+ *
+ * Frames decoded with their chroma planes (FRAME_I420, FRAME_YUYV) are just converted. When the backend only
+ * delivers the luma plane, the frame is decoded again in colour from a second capture of the same video, which
+ * is opened on first use and advances to each keyframe, seeking when it is more than RECOVERY_MAX_GRAB frames
+ * away. Keyframes are a small fraction of the video, so this costs much less than converting every frame.
+ * Frames must be given in video order, and the object must be used from a single thread.
+ */
+class ColourRecovery {
+public:
+    /**
+     * @param input    Video file the frames were decoded from
+     * @param index    Seek index of the video, so the frame decoded again is exactly the analysed one (NULL or empty:
+     *                 seek by frame number, unreliable on MPG/TOD streams)
+     */
+    explicit ColourRecovery(const string &input, const FrameIndex *index = NULL);
+
+    /**
+     * @brief Full resolution BGR version of a decoded frame
+     * @param packet    Decoded frame
+     * @retval BGR frame, or the luma plane itself if the colour frame could not be decoded again
+     */
+    Mat recover(const FramePacket &packet);
+
+    /// Number of frames decoded again by the second capture
+    int decoded() const { return nDecoded; }
+
+private:
+    string input;
+    const FrameIndex *index;
+    VideoCapture capture;
+    int nextIndex;          // index of the frame that the second capture returns next
+    int nDecoded;
+};
+
+/**
+ * @brief Per-frame analysis, independent of the keyframe: resize, grayscale conversion, features and blur
+ *
+ * The resized and grayscale images are left in the cache of the packet, for the following stages.
+ *
+ * @param packet        Packet with a decoded frame (img). Features and blur are filled in
+ * @param features      Feature backend used to extract keypoints and descriptors. NULL to skip the extraction
+ */
+void analyseFrame(FramePacket &packet, FeatureBackend *features);
+
+/**
+ * @brief Turns an analysed packet into the current keyframe, reusing its already computed features
+ * @param kframe    keyframe* pointer to the keyframe structure to be updated
+ * @param packet    Analysed frame that becomes the new keyframe
+ */
+void setKeyframe(keyframe *kframe, const FramePacket &packet);
+
+#endif // _PIPELINE_H_
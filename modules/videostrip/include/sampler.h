@@ -0,0 +1,56 @@
+/**
+ * @file sampler.h
+ * @brief Adaptive frame sampler, predicting how many frames can be skipped before the overlap reaches the target
+ * @version 1.0
+ * @date 17/10/2026
+ */
+#ifndef _SAMPLER_H_
+#define _SAMPLER_H_
+
+#include <vector>
+
+#define SKIP_MAX_FRAMES     30      //< Largest jump allowed between two analysed frames
+#define SKIP_HISTORY        8       //< Number of recent overlap measurements used to fit the decay rate
+#define SKIP_MIN_SAMPLES    3       //< Measurements required (since the last keyframe) before skipping
+#define SKIP_SAFETY         0.5     //< Fraction of the predicted distance to minOverlap that is actually skipped
+#define SKIP_MARGIN         0.05    //< Overlap margin above minOverlap where dense analysis is resumed
+
+/**
+ * @brief Predicts the overlap decay since the last keyframe, to skip frames that cannot trigger a new keyframe
+ *
+ * The overlap with the keyframe decreases almost linearly with the frame distance while the camera moves
+ * steadily. The decay rate is fitted (least squares) over the last SKIP_HISTORY measurements, and the
+ * number of frames left until the overlap reaches minOverlap + SKIP_MARGIN is extrapolated. Only a fraction
+ * of that distance is skipped, so the sampler approaches the threshold in decreasing steps and returns to
+ * dense (frame by frame) analysis before reaching it. The keyframe decision itself is unchanged: a new
+ * keyframe is still triggered by a measured overlap below minOverlap.
+ */
+class AdaptiveSampler {
+public:
+    /**
+     * @param minOverlap    Overlap threshold that triggers a new keyframe (-p)
+     * @param maxSkip       Maximum number of frames skipped at once
+     */
+    AdaptiveSampler(float minOverlap, int maxSkip = SKIP_MAX_FRAMES);
+
+    /// Starts a new prediction for the keyframe at the given frame index
+    void reset(int keyIndex);
+
+    /**
+     * @brief Adds a new overlap measurement and predicts how many of the following frames can be skipped
+     * @param index     Frame index of the measurement
+     * @param overlap   Measured overlap with the keyframe (negative if it could not be estimated)
+     * @retval int Number of frames after index that can be skipped (0: keep analysing every frame)
+     */
+    int update(int index, float overlap);
+
+private:
+    float minOverlap;
+    int maxSkip;
+    int keyIndex;
+    int lastSkip;                   // used to probe forward when the overlap is not decaying
+    std::vector<int> frames;        // frame distance to the keyframe of the recent measurements
+    std::vector<float> overlaps;
+};
+
+#endif // _SAMPLER_H_
@@ -0,0 +1,96 @@
+/**
+ * @file segments.h
+ * @brief Time-segmented processing of a single video, with keyframe chains reconciled at the segment seams
+ * @version 1.0
+ * @date 17/10/2026
+ *
+ * The input is split into N time segments. Each segment is processed by its own thread, with its own
+ * VideoCapture (positioned with the FrameIndex of the video, or a CAP_PROP_POS_MSEC seek), pipeline and keyframe state. Every segment starts
+ * a new keyframe chain on its first frame, so once all segments are done, the first keyframes of each chain
+ * are checked against the last keyframe of the previous segment, and the redundant ones are discarded.
+ * Surviving keyframes are then renamed following the same sequential numbering of the single segment mode.
+ */
+#ifndef _SEGMENTS_H_
+#define _SEGMENTS_H_
+
+#include "videostrip.hpp"
+#include "exporter.h"
+#include "selector.h"
+#include "frameindex.h"
+
+#define SEAM_HEAD   3   //< Keyframes at the start of each segment kept in memory, to reconcile the seam
+
+/// Parameters shared by all the segments
+struct SegmentSettings {
+    string input;           // input video file
+    string prefix;          // prefix of the exported files
+    Size frameSize;         // full resolution size of the video frames
+    double fps;             // video frame rate, used to seek each segment
+    int nWorkers;           // analysis threads for each segment
+    int exportWorkers;      // writer threads of the shared exporter, used to size the frame rings
+    bool lumaOnly;          // analyse the luma plane only (see PipelineOptions::lumaOnly)
+    SelectorSettings selection;     // keyframe selection parameters, each segment runs its own KeyframeSelector
+    const FrameIndex *index;        // seek index of the input, shared by the segments (NULL: seek by timestamp)
+
+    SegmentSettings() : fps(0), nWorkers(1), exportWorkers(1), lumaOnly(false), index(NULL) {}
+};
+
+/// Keyframe selected by a segment
+struct SegmentKeyframe {
+    int index;              // frame number in the input video
+    float overlap;          // overlap that triggered the keyframe (0 for the first keyframe of the segment)
+    float blur;             // blur estimation of the selected frame
+    string filename;        // temporary file written by the segment
+    Mat grey;               // grayscale resized frame, only kept for the keyframes involved in the seams
+    bool dropped;           // discarded during the reconciliation
+};
+
+/// Range of frames processed by a single worker
+struct Segment {
+    int id;
+    int first;              // nominal first frame, where the video is seeked to
+    int last;               // frames are processed up to this one (inclusive): the first frame of the next segment
+    bool ok;                // the segment could be opened and read
+    vector<SegmentKeyframe> keyframes;
+};
+
+/**
+ * @brief Processes a single segment, writing its keyframes with temporary names through the shared exporter
+ * @param segment   Segment to process. Its keyframes are appended to segment.keyframes
+ * @param settings  Selection parameters, common to every segment
+ * @param exporter  Keyframe exporter, shared by all the segments
+ * @param status    Status file, where the current frame of the segment is published
+ */
+void processSegment(Segment &segment, const SegmentSettings &settings, KeyframeExporter &exporter, StatusFile &status);
+
+/**
+ * @brief Discards the redundant keyframes at the start of each segment, checking them against the last
+ * keyframe of the previous segment
+ *
+ * A keyframe at the start of a segment is dropped when it lies before the last keyframe of the previous
+ * segment (both chains covered the seam), when the following keyframe still overlaps the previous segment
+ * above minOverlap, so the chain remains connected without it, or when it overlaps the last keyframe of the
+ * previous segment itself above minOverlap (a repeated view, typically the frame shared at the seam) and the
+ * following keyframe, if any, still overlaps the previous segment.
+ *
+ * @param segments  Processed segments, in video order
+ * @param settings  Selection parameters
+ * @retval int Number of keyframes discarded
+ */
+int reconcileSegments(vector<Segment> &segments, const SegmentSettings &settings);
+
+/**
+ * @brief Splits the video into nSegments, processes them in parallel and reconciles the seams
+ * @param settings      Selection parameters
+ * @param nSegments     Number of segments (and threads) to use
+ * @param firstFrame    First frame to process (after --timeSkip)
+ * @param nFrames       Total number of frames of the video
+ * @param exporter      Keyframe exporter
+ * @param reportFile    Report stream, where one line per final keyframe is appended
+ * @param status        Status file, updated by every segment
+ * @retval int Number of exported keyframes, or -1 if some segment could not be processed
+ */
+int processSegmented(const SegmentSettings &settings, int nSegments, int firstFrame, int nFrames,
+                     KeyframeExporter &exporter, std::ostream &reportFile, StatusFile &status);
+
+#endif // _SEGMENTS_H_
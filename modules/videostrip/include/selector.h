@@ -0,0 +1,128 @@
+/**
+ * @file selector.h
+ * @brief Keyframe selection engine: frames are pushed in video order, and the selected keyframes are pulled back
+ * @version 1.0
+ * @date 17/10/2026
+ */
+#ifndef _SELECTOR_H_
+#define _SELECTOR_H_
+
+#include <deque>
+
+#include "videostrip.hpp"
+#include "pipeline.h"
+#include "tracker.h"
+#include "sampler.h"
+
+/// Parameters of the keyframe selection
+struct SelectorSettings {
+    float minOverlap;       // overlap that triggers the search of a new keyframe (-p)
+    int kWindow;            // frames evaluated after the trigger, looking for the sharpest one (-k)
+    string featureType;     // feature backend (see FeatureBackend::create)
+    bool useFlow;           // track the keyframe with optical flow instead of matching every frame
+    bool adaptive;          // predict how many frames can be skipped (see AdaptiveSampler)
+    bool useGPU;            // estimate overlap and blur with the CUDA implementations (USE_GPU builds only)
+    float resizeFactor;     // resize applied to the raw frames given to push(const Mat&, int)
+
+    SelectorSettings() :
+        minOverlap(OVERLAP_MIN), kWindow(DEFAULT_KWINDOW), featureType(DEFAULT_FEATURES),
+        useFlow(false), adaptive(false), useGPU(false), resizeFactor(1.0) {}
+};
+
+/// Keyframe chosen by the selector
+struct SelectedKeyframe {
+    FramePacket packet;     // selected frame. Its ring slot (if any) is kept while this object lives
+    float overlap;          // overlap with the previous keyframe that triggered the search (0 for the first one)
+    float blur;             // blur estimation of the selected frame (0 for the first one)
+};
+
+/**
+ * @brief Selects keyframes from a sequence of frames, keeping all its state inside the object
+ *
+ * The first frame becomes the first keyframe. For every following frame, the overlap with the current keyframe
+ * is estimated, and once it falls below minOverlap, the sharpest frame among the next kWindow frames is chosen
+ * as the new keyframe. Frames are given with push(), in video order, and the selected keyframes are retrieved
+ * with pull(). Each selector owns its configuration, feature backend, tracker and keyframe, so several videos
+ * can be processed at once, from different threads, with one selector each.
+ */
+class KeyframeSelector {
+public:
+    explicit KeyframeSelector(const SelectorSettings &settings);
+
+    /// False if the requested feature backend is not available
+    bool valid() const { return !features.empty(); }
+
+    /**
+     * @brief Feeds the next frame, already analysed (e.g. by a FramePipeline with the same feature type)
+     * @param packet    Analysed frame. Frames must be given in video order, skipped frames are allowed
+     */
+    void push(const FramePacket &packet);
+
+    /**
+     * @brief Feeds the next raw frame, analysing it in the calling thread
+     * @param frame     Full resolution BGR frame. It is referenced, not copied: do not overwrite its buffer
+     * @param index     Frame number in the video
+     */
+    void push(const Mat &frame, int index);
+
+    /**
+     * @brief Retrieves the next selected keyframe, if any
+     * @retval true when a keyframe was returned
+     */
+    bool pull(SelectedKeyframe &selected);
+
+    /// Discards the current keyframe and any pending selection, to start a new sequence
+    void reset();
+
+    /**
+     * @brief Restarts the selection from a keyframe selected (and exported) by a previous run
+     * @param packet    Keyframe, with its features if they were kept. It is not returned by pull()
+     */
+    void resume(const FramePacket &packet);
+
+    /// Frames following the last pushed one that are not worth analysing (always 0 without adaptive sampling)
+    int skip() const { return skipHint; }
+
+    /// Whether the overlap was estimated for the last pushed frame (it is not during the refinement window)
+    bool measured() const { return lastMeasured; }
+
+    /// Overlap estimated for the last measured frame (-2.0 if it could not be estimated)
+    float overlap() const { return lastOverlap; }
+
+    /// Whether a refinement window is in progress: the next frames are only evaluated by their blur
+    bool refining() const { return windowLeft > 0; }
+
+    /// Frames evaluated so far in the current (or last) refinement window
+    int windowPosition() const { return windowPos; }
+
+    /// Blur of the best candidate of the current (or last) refinement window
+    float bestBlur() const { return windowBest; }
+
+    /// Current keyframe
+    const keyframe &current() const { return kframe; }
+
+private:
+    float estimateOverlap(const FramePacket &packet);
+    void adopt(const FramePacket &packet);
+    void commit(const FramePacket &packet, float overlap, float blur);
+
+    SelectorSettings settings;
+    Ptr<FeatureBackend> features;
+    OverlapTracker tracker;
+    AdaptiveSampler sampler;
+    keyframe kframe;
+    bool hasKeyframe;
+
+    FramePacket best;           // best candidate of the refinement window
+    float triggerOverlap;       // overlap that started the refinement window
+    int windowLeft;             // frames left in the refinement window (0: searching)
+    int windowPos;
+    float windowBest;
+
+    float lastOverlap;
+    bool lastMeasured;
+    int skipHint;
+    std::deque<SelectedKeyframe> selected;
+};
+
+#endif // _SELECTOR_H_
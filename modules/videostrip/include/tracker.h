@@ -0,0 +1,82 @@
+/**
+ * @file tracker.h
+ * @brief Overlap estimation by tracking keyframe corners with pyramidal Lucas-Kanade optical flow
+ * @version 1.0
+ * @date 17/10/2026
+ */
+#ifndef _TRACKER_H_
+#define _TRACKER_H_
+
+#include "videostrip.hpp"
+#include "pipeline.h"
+
+#define FLOW_MAX_CORNERS    300     //< Corners detected on each keyframe
+#define FLOW_MIN_TRACKS     30      //< Below this number of surviving tracks, fall back to descriptor matching
+#define FLOW_CORNER_QUALITY 0.01    //< Minimum corner quality, relative to the best corner (goodFeaturesToTrack)
+#define FLOW_MIN_DISTANCE   10      //< Minimum distance among detected corners, in pixels
+#define FLOW_WINDOW_SIZE    21      //< Lucas-Kanade search window size
+#define FLOW_MAX_LEVEL      3       //< Number of pyramid levels employed by Lucas-Kanade
+#define TRACK_LOST          -3.0    //< Returned by OverlapTracker::update when too few tracks remain
+
+/**
+ * @brief Tracks keyframe corners from frame to frame to estimate the overlap with the current keyframe
+ *
+ * Each keyframe provides a set of corners that are followed by sparse optical flow along the next frames.
+ * As every track keeps its original position on the keyframe, the homography to the keyframe is estimated
+ * directly from those correspondences: tracks are chained frame to frame but RANSAC errors do not build
+ * up. This is a fraction of the cost of detecting and matching descriptors on every frame. When too few
+ * tracks survive, the caller falls back to descriptor matching and reseeds the tracker (see trackOverlap).
+ */
+class OverlapTracker {
+public:
+    OverlapTracker(int maxCorners = FLOW_MAX_CORNERS, int minTracks = FLOW_MIN_TRACKS);
+
+    /// Starts tracking a new keyframe, given its packet
+    void reset(const FramePacket &key);
+
+    /**
+     * @brief Restarts the tracks on the current frame, when its homography to the keyframe is known
+     * @param packet    Current frame
+     * @param H         Homography mapping the current frame into the keyframe
+     */
+    void reseed(const FramePacket &packet, const Mat &H);
+
+    /**
+     * @brief Tracks the corners into a new frame and estimates its overlap with the keyframe
+     * @param packet    Frame following the last tracked one. Its cached pyramid is built if needed, and reused
+     *                  as the previous frame on the next update
+     * @param H         Output homography mapping the frame into the keyframe
+     * @retval float The normalized overlap, or TRACK_LOST if there are not enough tracks to trust it
+     */
+    float update(const FramePacket &packet, Mat &H);
+
+    /// Number of tracks alive after the last update
+    int tracks() const { return (int) currPts.size(); }
+
+private:
+    int maxCorners, minTracks;
+    Size frameSize;
+    FramePacket prev;               // last tracked frame. Holds its ring slot, and so its pyramid, until the next update
+    vector<Point2f> keyPts;         // corner positions on the keyframe
+    vector<Point2f> currPts;        // same corners, on the last tracked frame
+    vector<Point2f> nextPts;        // scratch buffers reused on every update
+    vector<uchar> status, inliers;
+    vector<float> err;
+};
+
+/**
+ * @brief Overlap of a packet with the keyframe, tracking with optical flow and matching descriptors only when needed
+ *
+ * When the tracker loses the keyframe, features are extracted for the current frame (and for the keyframe,
+ * the first time) and calcOverlap() is used instead. If that succeeds, the tracker is reseeded on the
+ * current frame using the homography found by descriptor matching.
+ *
+ * @param kframe    keyframe* pointer to current keyframe structure
+ * @param packet    Analysed frame, with its grayscale image
+ * @param tracker   Tracker following the current keyframe
+ * @param features  Feature backend employed for the fallback
+ * @retval float The normalized overlap, or -2.0 if it could not be estimated by any method
+ */
+float trackOverlap(keyframe *kframe, const FramePacket &packet, OverlapTracker &tracker, FeatureBackend &features);
+
+#endif // _TRACKER_H_
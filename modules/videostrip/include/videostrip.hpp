@@ -15,7 +15,6 @@
 /* Collaborators:                                                   */
 /* Victor Garcia - victorygarciac@gmail.com                         */
 /********************************************************************/
-//#define _VERBOSE_ON_
 
 #ifndef _VIDEOSTRIP_
 #define _VIDEOSTRIP_
@@ -26,16 +25,25 @@
 #include <iomanip>
 #include <sstream>
 #include <fstream>
+#include <memory>
 
 /// OpenCV libraries. May need review for the final release
 #include <opencv2/core.hpp>
 #include "opencv2/core/ocl.hpp"
 #include "opencv2/imgproc.hpp"
-#include "opencv2/highgui.hpp"
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/videoio.hpp>
+#ifndef HEADLESS
+    #include "opencv2/highgui.hpp"
+#endif
 #include <opencv2/video.hpp>
 #include <opencv2/features2d.hpp>
 #include "opencv2/calib3d.hpp"
-#include <opencv2/xfeatures2d.hpp>
+
+#include "framering.h"
+#include "features.h"
+#include "metrics.h"
+#include "../../common/headless.h"
 
 /// CUDA specific libraries
 #if USE_GPU
@@ -50,11 +58,14 @@
 #define OVERLAP_MIN  	0.4        //< Minimum desired minOverlap among consecutive key frames
 #define DEFAULT_KWINDOW 11         //< Search window size for best blur-based frame, after new key frame
 #define DEFAULT_TIMESKIP 0         //< Search window size for best blur-based frame, after new key frame
+#define DEFAULT_QUEUE_SIZE 16      //< Capacity of the queues connecting decode, analysis and export stages
 
 // C++ namespaces
 using namespace cv;
 using namespace cv::cuda;
+#ifdef HAVE_OPENCV_XFEATURES2D
 using namespace cv::xfeatures2d;
+#endif
 using namespace std;
 
 // Structure to save the reference frame data, useful to reuse keypoints and descriptors
@@ -65,37 +76,83 @@ typedef struct {
     Mat descriptors;            // Descriptors of refererence frame
     Mat img;                    // reference frame
     Mat res_img;                // resized frame to TARGET_WIDTH x TARGET_HEIGHT
+    Mat grey;                   // grayscale version of res_img
+    std::shared_ptr<FrameSlot> slot;    // ring slot holding img/res_img, kept while this is the keyframe
+#if USE_GPU
+    cuda::GpuMat descriptorsGPU;        // descriptors of the keyframe, kept on the device for the GPU matcher
+#endif
 } keyframe;
 
-/** @brief Obtains the area of the overlap between two frames from their homography matrix
+/*! @fn float calcOverlap(keyframe* kframe, Mat img_object, FeatureBackend &features)
+    @brief Calculates the percentage of overlapping among two frames, by estimating the Homography matrix.
 
-The homography matrix must be previously computed (and validated) using any method of estimation, between an origin image and a reference image. Then it creates a 2D rect polygon representing the boundaries of the origin image, and transforms it according the homography H. Current implementation creates an intersection mask and counts the resulting non-zero elements. A calling example would be:
+    Detects features on img_object (and on the keyframe, if it is a new one), matches them against the keyframe and
+    calls overlapArea() with the resulting homography.
 
-@code{.cpp}
-        Mat H = findHomography(obj, scene, RANSAC);
-	if (H.empty())	return -2.0;
-        float calcOverlap = overlapArea(H);
-   ...
-@endcode
+    @param kframe       keyframe* pointer to current keyframe structure
+    @param img_object   cv::Mat container of the (resized) target frame
+    @param features     Feature backend employed for detection and matching
+    @retval float The normalized overlap, or -2.0 if the homography could not be estimated
+*/
+float calcOverlap(keyframe* kframe, Mat image_object, FeatureBackend &features);
 
-@param H cv::Mat containing the homography transformation
-@return float The normalized overlap among two given frames
- */
-float calcOverlap(keyframe* kframe, Mat image_object);
+/*! @fn float calcOverlap(keyframe* kframe, const vector<KeyPoint> &keypoints_object, const Mat &descriptors_object, FeatureBackend &features)
+    @brief Calculates the overlap against the current keyframe for a frame whose features were already extracted
+
+    Same as calcOverlap(keyframe*, Mat, FeatureBackend&) but skips the detection step, so features can be computed beforehand
+    (e.g. by the analysis workers of the frame pipeline). The keyframe must already contain its keypoints and descriptors,
+    extracted with the same type of features.
+
+    @param kframe               keyframe* pointer to current keyframe structure, with valid features
+    @param keypoints_object     Keypoints of the target frame
+    @param descriptors_object   Descriptors of the target frame
+    @param features             Feature backend, provides the matcher suited to the descriptor type
+    @param homography           Optional output, homography mapping the target frame into the keyframe
+    @retval float The normalized overlap, or -2.0 if the homography could not be estimated
+*/
+float calcOverlap(keyframe* kframe, const vector<KeyPoint> &keypoints_object, const Mat &descriptors_object, FeatureBackend &features, Mat *homography = NULL);
+
+/*! @fn Mat matchHomography(const vector<KeyPoint> &keypoints_object, const Mat &descriptors_object, const vector<KeyPoint> &keypoints_scene, const Mat &descriptors_scene, FeatureBackend &features, int *nMatches, int *nInliers)
+    @brief Matches two sets of features (ratio test) and estimates the homography between them with RANSAC
+
+    This is the estimation step of calcOverlap(), without any console output, so it can be used for any pair of frames.
+
+    @param keypoints_object     Keypoints of the frame to be mapped
+    @param descriptors_object   Its descriptors
+    @param keypoints_scene      Keypoints of the reference frame
+    @param descriptors_scene    Its descriptors, of the same type
+    @param features             Feature backend, provides the matcher suited to the descriptor type
+    @param nMatches             Optional output, number of matches that passed the ratio test
+    @param nInliers             Optional output, number of RANSAC inliers
+    @retval Mat Homography mapping the object frame into the scene frame, empty if it could not be estimated
+*/
+Mat matchHomography(const vector<KeyPoint> &keypoints_object, const Mat &descriptors_object,
+                    const vector<KeyPoint> &keypoints_scene, const Mat &descriptors_scene,
+                    FeatureBackend &features, int *nMatches = NULL, int *nInliers = NULL);
+
+
+/*! @fn float calcOverlapGPU(keyframe* kframe, Mat img_object)
+    @brief Calculates the percentage of overlapping among two frames using GPU, by estimating the Homography matrix.
 
+    Given two images, computes their homography matrix H using SURF features. With H, calls overlapArea(H) to obtain their normalized overlap area. Both images must have enough common features to provide a valid homography matrix
 
-// See description in function definition
+    @param img_scene	keyframe* pointer to current keyframe structure
+    @param img_object	cv::Mat container of target frame to be compared against current keyframe
+	@brief retval		The normalized overlap among two given frame
+*/
 float calcOverlapGPU(keyframe* kframe, Mat image_object);
 
 
-/*! @fn float calcBlur (Mat frame)
+/*! @fn float calcBlur (const Mat &frame)
     @brief Calculates the "blur" of a given Mat frame, based on the standard deviation of the Laplacian of the input frame
  
     Applies a Laplacian filter to the input image, and then return its standard deviation as an estimated of the image "blur". It assumes that more blurred images produces a lower value ot stdev(Laplacion(img)), because the Laplacian acts as a simple border detector.
+    The grayscale conversion, the 3x3 Laplacian and the standard deviation are computed in a single pass over the frame,
+    giving the same result as cvtColor + Laplacian(CV_16S) + meanStdDev, without intermediate images.
 
-    @param frame cv::Mat container of the input frame
+    @param frame cv::Mat container of the input frame (8-bit BGR, BGRA or grayscale)
     @retval float The estimated blur for the given frame*/
-float calcBlur(Mat frame);
+float calcBlur(const Mat &frame);
 
 
 /*! @fn float calcBlurGPU (Mat frame)
@@ -106,15 +163,21 @@ float calcBlur(Mat frame);
 float calcBlurGPU(Mat frame);
 
 
-/*! @fn float calcOverlapGPU(keyframe* kframe, Mat img_object)
-    @brief Calculates the percentage of overlapping among two frames using GPU, by estimating the Homography matrix.
+/** @brief Obtains the normalized overlap between two frames from their homography matrix
 
-    Given two images, computes their homography matrix H using SURF features. With H, calls overlapArea(H) to obtain their normalized overlap area. Both images must have enough common features to provide a valid homography matrix
+The homography matrix must be previously computed (and validated) using any method of estimation, between an origin image and a reference image, both of size frameSize. The boundaries of the origin image are transformed according to H, and the resulting quad is clipped against the reference frame rectangle (Sutherland-Hodgman). The overlap is the intersection area over the union area of both frames (IoU), computed analytically without any image allocation. A calling example would be:
 
-    @param img_scene	keyframe* pointer to current keyframe structure
-    @param img_object	cv::Mat container of target frame to be compared against current keyframe
-	@brief retval		The normalized overlap among two given frame
-*/
-float overlapArea(Mat H);
+@code{.cpp}
+        Mat H = findHomography(obj, scene, RANSAC);
+	if (H.empty())	return -2.0;
+        float overlap = overlapArea(H, kframe->res_img.size());
+   ...
+@endcode
+
+@param H cv::Mat 3x3 CV_64F homography transformation
+@param frameSize Size of the frames employed to estimate H (i.e. the resized frames)
+@return float The normalized overlap among two given frames, in the range [0, 1]
+ */
+float overlapArea(const Mat &H, Size frameSize);
 
 #endif // _VIDEOSTRIP_
@@ -0,0 +1,237 @@
+/********************************************************************/
+/* Project: uwimageproc							*/
+/* Module: 	Videostrip						*/
+/* File: 	batch.cpp                                               */
+/* Created:		17/10/2026                                          */
+/* Description
+	Batch mode for videostrip. Videos found in a directory are scheduled on a pool of workers,
+	each one running its own keyframe selector, and a throughput summary is written at the end.
+*/
+/********************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "../include/batch.h"
+#include "../include/frameindex.h"
+
+static std::mutex coutMutex;    // workers report their progress from different threads
+
+// lower case extension of a file name, without the dot
+static string fileExtension(const string &file) {
+    size_t dot = file.find_last_of('.');
+    size_t slash = file.find_last_of('/');
+    if (dot == string::npos || (slash != string::npos && dot < slash)) return "";
+    string ext = file.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext;
+}
+
+vector<string> findVideos(const string &dir) {
+    vector<String> files;
+    glob(dir, files, true);     // recursive listing of every file under dir
+
+    istringstream known(BATCH_EXTENSIONS);
+    vector<string> extensions;
+    string ext;
+    while (known >> ext) extensions.push_back(ext);
+
+    vector<string> videos;
+    for (size_t i = 0; i < files.size(); i++)
+        if (std::find(extensions.begin(), extensions.end(), fileExtension(files[i])) != extensions.end())
+            videos.push_back(files[i]);
+    std::sort(videos.begin(), videos.end());
+    return videos;
+}
+
+vector<string> videoNames(const string &dir, const vector<string> &videos) {
+    vector<string> names(videos.size()), extensions(videos.size());
+    std::map<string, int> count;
+    for (size_t i = 0; i < videos.size(); i++) {
+        string relative = videos[i];
+        if (relative.compare(0, dir.size(), dir) == 0) relative = relative.substr(dir.size());
+        relative = relative.substr(relative.find_first_not_of('/') == string::npos ? 0 : relative.find_first_not_of('/'));
+        extensions[i] = fileExtension(relative);
+        if (!extensions[i].empty()) relative.erase(relative.size() - extensions[i].size() - 1);
+        std::replace(relative.begin(), relative.end(), '/', '_');
+        names[i] = relative;
+        count[relative]++;
+    }
+    // cameras restart their numbering in every folder, and may record the same clip in several formats
+    std::map<string, int> repeated;
+    for (size_t i = 0; i < names.size(); i++) {
+        if (count[names[i]] > 1 && !extensions[i].empty()) names[i] += "_" + extensions[i];
+        repeated[names[i]]++;
+    }
+    for (size_t i = 0; i < names.size(); i++) {
+        if (repeated[names[i]] < 2) continue;
+        ostringstream unique;
+        unique << names[i] << "_" << i;
+        names[i] = unique.str();
+    }
+    return names;
+}
+
+BatchResult processVideo(const string &input, const string &prefix, const BatchSettings &settings, KeyframeExporter &exporter) {
+    BatchResult result;
+    result.input = input;
+    result.prefix = prefix;
+    result.ok = false;
+    result.frames = result.analysed = result.keyframes = 0;
+    result.seconds = 0;
+    double t = (double) getTickCount();
+
+    VideoCapture capture(input);
+    if (!capture.isOpened()) return result;
+    int videoWidth = capture.get(CAP_PROP_FRAME_WIDTH);
+    int videoHeight = capture.get(CAP_PROP_FRAME_HEIGHT);
+    if (videoWidth <= 0 || videoHeight <= 0) return result;
+    int firstFrame = -1;    // negative: frames are numbered from the position reported by the capture
+    FrameIndex index;       // also used to decode again the exported frames in luma mode
+    if (settings.useIndex && (settings.timeSkip > 0 || settings.lumaOnly)) index.open(input, false);
+    if (settings.timeSkip > 0) {
+        if (!index.empty()) firstFrame = index.frameAt(settings.timeSkip * 1000.0);
+        if (firstFrame < 0 || !index.seek(capture, firstFrame)) {
+            firstFrame = -1;
+            capture.set(CAP_PROP_POS_MSEC, settings.timeSkip * 1000);
+        }
+    }
+
+    SelectorSettings selection = settings.selection;
+    selection.resizeFactor = (float) TARGET_WIDTH / videoWidth;
+
+    // the pool already keeps every core busy with one video each, so every video gets a single analysis worker
+    PipelineOptions options;
+    options.nWorkers = 1;
+    options.queueSize = DEFAULT_QUEUE_SIZE;
+    options.resizeFactor = selection.resizeFactor;
+    options.featureType = selection.featureType;
+    options.detectFeatures = !selection.useFlow;
+    options.lumaOnly = settings.lumaOnly;
+
+    FrameRing ring(selection.kWindow + options.nWorkers + settings.exportWorkers + 4, Size(videoWidth, videoHeight),
+                   settings.lumaOnly ? CV_8UC1 : CV_8UC3);
+    FramePipeline pipeline(capture, ring, options);
+    ColourRecovery recovery(input, &index);
+    KeyframeSelector selector(selection);
+    FramePacket packet;
+    SelectedKeyframe selected;
+    ostringstream name;
+
+    ofstream reportFile((prefix + "videostrip_report.txt").c_str(), std::ofstream::out);
+    reportFile << "videostrip" << endl;
+    reportFile << "\tOpenCV version:\t" << CV_VERSION << endl;
+    reportFile << "\tGit commit:\t" << GIT_COMMIT << endl;
+    reportFile << "***************************************" << endl;
+    reportFile << "Input:\t" << input << endl;
+    reportFile << "\tSize:\t" << videoWidth << " x " << videoHeight << endl;
+    reportFile << "Target minOverlap:\t" << selection.minOverlap << endl;
+    reportFile << "Window size:\t" << selection.kWindow << endl;
+    reportFile << "Features:\t" << selection.featureType << endl;
+    reportFile << "***************************************" << endl;
+    reportFile << "ID\tFrame\tFilename\tOverlap\tBlur" << endl;
+
+    int firstIndex = -1, lastIndex = -1;
+    pipeline.start(firstFrame);
+    while (pipeline.next(packet) && !stopRequested()) {
+        if (firstIndex < 0) firstIndex = packet.index;
+        lastIndex = packet.index;
+        result.analysed++;
+
+        selector.push(packet);
+        if (selector.skip() > 0) pipeline.skipTo(packet.index + selector.skip() + 1);
+
+        while (selector.pull(selected)) {
+            name.str("");
+            name << prefix << setfill('0') << setw(4) << result.keyframes;
+            string exportedName = exporter.write(name.str(), recovery.recover(selected.packet), selected.packet.slot);
+            reportFile << result.keyframes << "\t" << selected.packet.index << "\t" << exportedName << "\t"
+                       << selected.overlap << "\t" << selected.blur << endl;
+            result.keyframes++;
+        }
+        selected = SelectedKeyframe();
+    }
+    pipeline.stop();
+    reportFile.close();
+
+    result.ok = (result.analysed > 0);
+    result.frames = (firstIndex < 0) ? 0 : lastIndex - firstIndex + 1;
+    result.seconds = ((double) getTickCount() - t) / getTickFrequency();
+    return result;
+}
+
+int processBatch(const string &dir, const BatchSettings &settings, KeyframeExporter &exporter, StatusFile &status) {
+    vector<string> videos = findVideos(dir);
+    if (videos.empty()) return -1;
+    vector<string> names = videoNames(dir, videos);
+    cout << "Videos found:\t" << videos.size() << endl;
+    std::atomic<int> nDone(0);
+    status.set("videos", (int) videos.size());
+    status.set("videos_done", 0);
+    status.update("running", true);
+
+    vector<BatchResult> results(videos.size());
+    std::atomic<int> nextVideo(0);
+    double t = (double) getTickCount();
+
+    // each worker takes the next pending video, until the list is exhausted (or a stop is requested)
+    auto worker = [&]() {
+        for (int i = nextVideo++; i < (int) videos.size() && !stopRequested(); i = nextVideo++) {
+            string file = videos[i].substr(videos[i].find_last_of('/') + 1);
+            results[i] = processVideo(videos[i], settings.prefix + names[i] + "_", settings, exporter);
+            status.set("videos_done", ++nDone);
+            status.update("running", true);
+
+            std::lock_guard<std::mutex> lock(coutMutex);
+            if (results[i].ok)
+                cout << "[" << i + 1 << "/" << videos.size() << "] " << file << ":\t" << results[i].keyframes
+                     << " keyframes, " << results[i].frames / std::max(results[i].seconds, 1e-3) << " fps" << endl;
+            else
+                cerr << "[" << i + 1 << "/" << videos.size() << "] Unable to process: " << videos[i] << endl;
+        }
+    };
+    int nWorkers = std::max(1, std::min(settings.nWorkers, (int) videos.size()));
+    vector<std::thread> workers;
+    for (int w = 0; w < nWorkers; w++)
+        workers.push_back(std::thread(worker));
+    for (int w = 0; w < nWorkers; w++)
+        workers[w].join();
+    exporter.flush();
+    double elapsed = ((double) getTickCount() - t) / getTickFrequency();
+
+    // throughput summary, one line per file
+    ofstream summaryFile((settings.prefix + BATCH_SUMMARY_FILE).c_str(), std::ofstream::out);
+    summaryFile << "File\tFrames\tAnalysed\tKeyframes\tTime [s]\tFPS" << endl;
+    int nFailed = 0, totalFrames = 0, totalKeyframes = 0;
+    for (size_t i = 0; i < results.size(); i++) {
+        const BatchResult &r = results[i];
+        if (r.input.empty()) {          // never started, the run was stopped before
+            summaryFile << videos[i] << "\tSKIPPED" << endl;
+            continue;
+        }
+        if (!r.ok) {
+            nFailed++;
+            summaryFile << r.input << "\tFAILED" << endl;
+            continue;
+        }
+        totalFrames += r.frames;
+        totalKeyframes += r.keyframes;
+        summaryFile << r.input << "\t" << r.frames << "\t" << r.analysed << "\t" << r.keyframes << "\t"
+                    << r.seconds << "\t" << r.frames / std::max(r.seconds, 1e-3) << endl;
+    }
+    summaryFile << "Total\t" << totalFrames << "\t\t" << totalKeyframes << "\t" << elapsed << "\t"
+                << totalFrames / std::max(elapsed, 1e-3) << endl;
+    summaryFile.close();
+
+    cout << "***************************************" << endl;
+    cout << "Videos:\t" << nDone - nFailed << " / " << videos.size() << endl;
+    cout << "Keyframes:\t" << totalKeyframes << endl;
+    cout << "Elapsed:\t" << elapsed << " s" << endl;
+    cout << "Throughput:\t" << totalFrames / std::max(elapsed, 1e-3) << " fps (" << nWorkers << " workers)" << endl;
+    cout << "Summary:\t" << settings.prefix + BATCH_SUMMARY_FILE << endl;
+    return nFailed;
+}
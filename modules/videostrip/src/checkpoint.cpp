@@ -0,0 +1,68 @@
+/********************************************************************/
+/* Project: uwimageproc							*/
+/* Module: 	Videostrip						*/
+/* File: 	checkpoint.cpp                                          */
+/* Created:		17/10/2026                                          */
+/* Description
+	Periodic checkpoints of a videostrip run, written with cv::FileStorage (gzipped YAML) and
+	replaced atomically, so a preempted or crashed run can be resumed with --resume.
+*/
+/********************************************************************/
+
+#include <cstdio>
+
+#include "../include/checkpoint.h"
+
+string checkpointFileName(const string &prefix) {
+    return prefix + "videostrip_checkpoint.yml.gz";
+}
+
+bool saveCheckpoint(const string &filename, const Checkpoint &checkpoint) {
+    // FileStorage picks the format from the extension, so the temporary name keeps it
+    string tmpName = filename.substr(0, filename.size() - 7) + ".tmp.yml.gz";
+    {
+        FileStorage fs(tmpName, FileStorage::WRITE);
+        if (!fs.isOpened()) return false;
+        fs << "version" << CHECKPOINT_VERSION;
+        fs << "input" << checkpoint.input;
+        fs << "videoFrames" << checkpoint.videoFrames;
+        fs << "frameSize" << checkpoint.frameSize;
+        fs << "featureType" << checkpoint.featureType;
+        fs << "position" << checkpoint.position;
+        fs << "outputCounter" << checkpoint.outputCounter;
+        fs << "reportOffset" << checkpoint.reportOffset;    // FileStorage has no 64 bit integers
+        fs << "keyframeIndex" << checkpoint.keyframeIndex;
+        fs << "grey" << checkpoint.grey;
+        fs << "keypoints" << checkpoint.keypoints;
+        fs << "descriptors" << checkpoint.descriptors;
+    }
+    if (std::rename(tmpName.c_str(), filename.c_str()) != 0) {
+        std::remove(tmpName.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool loadCheckpoint(const string &filename, Checkpoint &checkpoint) {
+    FileStorage fs;
+    try {
+        if (!fs.open(filename, FileStorage::READ)) return false;
+    }
+    catch (const cv::Exception &) {
+        return false;       // truncated or corrupted file
+    }
+    if ((int) fs["version"] != CHECKPOINT_VERSION) return false;
+
+    fs["input"] >> checkpoint.input;
+    fs["videoFrames"] >> checkpoint.videoFrames;
+    fs["frameSize"] >> checkpoint.frameSize;
+    fs["featureType"] >> checkpoint.featureType;
+    fs["position"] >> checkpoint.position;
+    fs["outputCounter"] >> checkpoint.outputCounter;
+    fs["reportOffset"] >> checkpoint.reportOffset;
+    fs["keyframeIndex"] >> checkpoint.keyframeIndex;
+    fs["grey"] >> checkpoint.grey;
+    fs["keypoints"] >> checkpoint.keypoints;
+    fs["descriptors"] >> checkpoint.descriptors;
+    return checkpoint.keyframeIndex >= 0 && !checkpoint.grey.empty();
+}
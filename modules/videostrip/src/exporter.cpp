@@ -0,0 +1,121 @@
+/********************************************************************/
+/* Project: uwimageproc							*/
+/* Module: 	Videostrip						*/
+/* File: 	exporter.cpp                                            */
+/* Created:		17/10/2026                                          */
+/* Description
+	Keyframe exporter. Encoding a full resolution frame takes tens of milliseconds, so exported
+	keyframes are written by a pool of threads while the selection loop keeps going.
+*/
+/********************************************************************/
+
+#include "../include/exporter.h"
+
+JpegEncoder::JpegEncoder(int quality) {
+    params.push_back(IMWRITE_JPEG_QUALITY);
+    params.push_back(std::min(100, std::max(0, quality)));
+}
+
+bool JpegEncoder::write(const string &filename, const Mat &img) const {
+    return imwrite(filename, img, params);
+}
+
+PngEncoder::PngEncoder(int compression) {
+    params.push_back(IMWRITE_PNG_COMPRESSION);
+    params.push_back(std::min(9, std::max(0, compression)));
+}
+
+bool PngEncoder::write(const string &filename, const Mat &img) const {
+    return imwrite(filename, img, params);
+}
+
+PpmEncoder::PpmEncoder() {
+    params.push_back(IMWRITE_PXM_BINARY);
+    params.push_back(1);
+}
+
+bool PpmEncoder::write(const string &filename, const Mat &img) const {
+    return imwrite(filename, img, params);
+}
+
+Ptr<FrameEncoder> createEncoder(const string &format, int quality) {
+    if (format == "jpg" || format == "jpeg")
+        return Ptr<FrameEncoder>(new JpegEncoder(quality < 0 ? DEFAULT_JPEG_QUALITY : quality));
+    if (format == "png")
+        return Ptr<FrameEncoder>(new PngEncoder(quality < 0 ? DEFAULT_PNG_COMPRESSION : quality));
+    if (format == "ppm" || format == "raw")
+        return Ptr<FrameEncoder>(new PpmEncoder());
+    return Ptr<FrameEncoder>();
+}
+
+//*****************************************************************************
+
+KeyframeExporter::KeyframeExporter(Ptr<FrameEncoder> encoder, int nWorkers, int queueSize) :
+    encoder(encoder),
+    jobs(queueSize),
+    pending(0),
+    failed(0) {
+    for (int i = 0; i < std::max(1, nWorkers); i++)
+        workers.push_back(std::thread(&KeyframeExporter::writeLoop, this));
+}
+
+KeyframeExporter::~KeyframeExporter() {
+    close();
+}
+
+string KeyframeExporter::write(const string &basename, const Mat &img, const std::shared_ptr<void> &owner) {
+    Job job;
+    job.filename = basename + encoder->extension();
+    job.img = img;
+    job.owner = owner;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        pending++;
+    }
+    if (!jobs.push(job)) {  // exporter already closed, the frame is lost
+        std::lock_guard<std::mutex> lock(mtx);
+        pending--;
+        failed++;
+        doneCond.notify_all();
+    }
+    return job.filename;
+}
+
+void KeyframeExporter::flush() {
+    std::unique_lock<std::mutex> lock(mtx);
+    doneCond.wait(lock, [this] { return pending == 0; });
+}
+
+void KeyframeExporter::close() {
+    // closing the queue still lets the workers drain the frames already submitted
+    jobs.close();
+    for (size_t i = 0; i < workers.size(); i++)
+        if (workers[i].joinable()) workers[i].join();
+    workers.clear();
+}
+
+int KeyframeExporter::failures() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return failed;
+}
+
+void KeyframeExporter::writeLoop() {
+    Job job;
+    while (jobs.pop(job)) {
+        bool ok = false;
+        try {
+            ScopedTimer timer(METRIC_EXPORT);
+            ok = encoder->write(job.filename, job.img);
+        }
+        catch (cv::Exception &e) {
+            cerr << endl << "[KeyframeExporter] " << e.what() << endl;
+        }
+        if (!ok) cerr << endl << "[KeyframeExporter] Unable to write " << job.filename << endl;
+        job = Job();    // do not hold the frame buffer while waiting for the next job
+
+        std::lock_guard<std::mutex> lock(mtx);
+        pending--;
+        if (!ok) failed++;
+        doneCond.notify_all();
+    }
+}
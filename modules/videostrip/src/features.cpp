@@ -0,0 +1,64 @@
+/********************************************************************/
+/* Project: uwimageproc							*/
+/* Module: 	Videostrip						*/
+/* File: 	features.cpp                                            */
+/* Created:		17/10/2026                                          */
+/* Description
+	Feature backends for the homography based overlap estimation. Detectors and matchers are
+	created once per backend instead of once per frame.
+*/
+/********************************************************************/
+
+#include <algorithm>
+#include <cctype>
+
+#include "../include/features.h"
+#include "../include/metrics.h"
+
+cv::Ptr<FeatureBackend> FeatureBackend::create(const std::string &name) {
+    std::string type = name;
+    std::transform(type.begin(), type.end(), type.begin(), ::toupper);
+
+    cv::Ptr<cv::Feature2D> detector;
+#ifdef HAVE_OPENCV_XFEATURES2D
+    if (type == "SURF")
+        detector = cv::xfeatures2d::SURF::create(SURF_MIN_HESSIAN);
+#endif
+    if (type == "ORB")
+        detector = cv::ORB::create(ORB_MAX_FEATURES);
+    else if (type == "AKAZE")
+        detector = cv::AKAZE::create();
+    else if (type == "BRISK")
+        detector = cv::BRISK::create();
+
+    if (detector.empty()) return cv::Ptr<FeatureBackend>();
+    return cv::Ptr<FeatureBackend>(new FeatureBackend(type, detector));
+}
+
+std::string FeatureBackend::available() {
+#ifdef HAVE_OPENCV_XFEATURES2D
+    return "SURF, ORB, AKAZE, BRISK";
+#else
+    return "ORB, AKAZE, BRISK";
+#endif
+}
+
+FeatureBackend::FeatureBackend(const std::string &type, cv::Ptr<cv::Feature2D> detector) :
+    type(type),
+    detector(detector) {
+    // each descriptor reports its own distance: L2 for SURF, Hamming for the binary ones
+    normType = detector->defaultNorm();
+    matcher = cv::BFMatcher::create(normType);
+}
+
+void FeatureBackend::detectAndCompute(const cv::Mat &img_grey, std::vector<cv::KeyPoint> &keypoints, cv::Mat &descriptors) {
+    ScopedTimer timer(METRIC_DETECT);
+    detector->detectAndCompute(img_grey, cv::noArray(), keypoints, descriptors);
+    timer.stop();
+    recordValue(METRIC_KEYPOINTS, keypoints.size());
+}
+
+void FeatureBackend::knnMatch(const cv::Mat &query, const cv::Mat &train, std::vector<std::vector<cv::DMatch> > &matches) {
+    ScopedTimer timer(METRIC_MATCH);
+    matcher->knnMatch(query, train, matches, 2);
+}
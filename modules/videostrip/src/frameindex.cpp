@@ -0,0 +1,143 @@
+/********************************************************************/
+/* Project: uwimageproc							*/
+/* Module: 	Videostrip						*/
+/* File: 	frameindex.cpp                                          */
+/* Created:		17/10/2026                                          */
+/* Description
+	Per-video seek index: timestamps of every frame and verified seek anchors, built with a
+	single grab() pass and cached in a binary sidecar (<video>.vsidx) next to the video.
+*/
+/********************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <sys/stat.h>
+
+#include "../include/frameindex.h"
+
+static const char INDEX_MAGIC[4] = {'V', 'S', 'I', 'X'};
+
+// size and modification time of a file, to detect stale sidecars
+static bool fileStamp(const string &filename, int64_t &size, int64_t &time) {
+    struct stat info;
+    if (stat(filename.c_str(), &info) != 0) return false;
+    size = (int64_t) info.st_size;
+    time = (int64_t) info.st_mtime;
+    return true;
+}
+
+template <typename T> static void writeValue(ofstream &file, const T &value) {
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T> static bool readValue(ifstream &file, T &value) {
+    return (bool) file.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+string indexFileName(const string &video) {
+    return video + ".vsidx";
+}
+
+FrameIndex::FrameIndex() :
+    fileSize(0),
+    fileTime(0) {
+}
+
+bool FrameIndex::open(const string &video, bool verbose) {
+    if (load(video)) return true;
+    if (verbose) cout << "Building seek index of: " << video << " ..." << std::flush;
+    if (!build(video)) {
+        if (verbose) cout << endl;
+        return false;
+    }
+    if (verbose) cout << " " << frames() << " frames, " << nAnchors() << " seek anchors" << endl;
+    // the index still works when the sidecar cannot be written (e.g. read-only storage), it is just not cached
+    if (!save() && verbose)
+        cout << "Unable to write seek index: " << indexFileName(video) << endl;
+    return true;
+}
+
+bool FrameIndex::load(const string &filename) {
+    int64_t size, time;
+    if (!fileStamp(filename, size, time)) return false;
+    ifstream file(indexFileName(filename).c_str(), std::ifstream::binary);
+    if (!file) return false;
+
+    char magic[4];
+    int32_t version, nFrames, nAnchors;
+    int64_t indexSize, indexTime;
+    if (!file.read(magic, 4) || std::memcmp(magic, INDEX_MAGIC, 4) != 0) return false;
+    if (!readValue(file, version) || version != INDEX_VERSION) return false;
+    if (!readValue(file, indexSize) || !readValue(file, indexTime) || indexSize != size || indexTime != time) return false;
+    if (!readValue(file, nFrames) || !readValue(file, nAnchors) || nFrames <= 0 || nAnchors <= 0 || nAnchors > nFrames)
+        return false;
+
+    vector<double> t(nFrames);
+    vector<int32_t> a(nAnchors);
+    if (!file.read(reinterpret_cast<char*>(&t[0]), nFrames * sizeof(double))) return false;
+    if (!file.read(reinterpret_cast<char*>(&a[0]), nAnchors * sizeof(int32_t))) return false;
+
+    video = filename;
+    fileSize = size;
+    fileTime = time;
+    timestamps.swap(t);
+    anchors.assign(a.begin(), a.end());
+    return true;
+}
+
+bool FrameIndex::build(const string &filename) {
+    timestamps.clear();
+    anchors.clear();
+    if (!fileStamp(filename, fileSize, fileTime)) return false;
+    VideoCapture capture(filename);
+    if (!capture.isOpened()) return false;
+    video = filename;
+
+    // grab() demuxes and decodes, but skips the colour conversion of retrieve()
+    while (capture.grab()) timestamps.push_back(capture.get(CAP_PROP_POS_MSEC));
+    if (timestamps.empty()) return false;
+
+    // the first frame can always be reached by seeking to the start. Any other anchor is kept only if the backend
+    // lands exactly on it: same timestamp, closer to it than to any of its neighbours
+    anchors.push_back(0);
+    int n = (int) timestamps.size();
+    for (int k = INDEX_ANCHOR_SPACING; k < n - 1; k += INDEX_ANCHOR_SPACING) {
+        double tolerance = 0.5 * std::min(timestamps[k] - timestamps[k - 1], timestamps[k + 1] - timestamps[k]);
+        if (tolerance <= 0) continue;       // duplicated or unordered timestamps, the landing frame is ambiguous
+        if (!capture.set(CAP_PROP_POS_FRAMES, k) || !capture.grab()) continue;
+        if (std::fabs(capture.get(CAP_PROP_POS_MSEC) - timestamps[k]) < tolerance) anchors.push_back(k);
+    }
+    return true;
+}
+
+bool FrameIndex::save() const {
+    if (empty()) return false;
+    ofstream file(indexFileName(video).c_str(), std::ofstream::binary);
+    if (!file) return false;
+    file.write(INDEX_MAGIC, 4);
+    writeValue(file, (int32_t) INDEX_VERSION);
+    writeValue(file, fileSize);
+    writeValue(file, fileTime);
+    writeValue(file, (int32_t) timestamps.size());
+    writeValue(file, (int32_t) anchors.size());
+    file.write(reinterpret_cast<const char*>(&timestamps[0]), timestamps.size() * sizeof(double));
+    for (size_t i = 0; i < anchors.size(); i++) writeValue(file, (int32_t) anchors[i]);
+    return file.good();
+}
+
+int FrameIndex::frameAt(double msec) const {
+    // timestamps of broken streams may jump back, so the first frame reaching the time is returned
+    for (size_t i = 0; i < timestamps.size(); i++)
+        if (timestamps[i] - timestamps[0] >= msec) return (int) i;
+    return frames();
+}
+
+bool FrameIndex::seek(VideoCapture &capture, int frame) const {
+    if (empty() || frame < 0 || frame >= frames()) return false;
+    int anchor = *(std::upper_bound(anchors.begin(), anchors.end(), frame) - 1);
+    if (!capture.set(CAP_PROP_POS_FRAMES, anchor)) return false;
+    for (int i = anchor; i < frame; i++)
+        if (!capture.grab()) return false;
+    return true;
+}
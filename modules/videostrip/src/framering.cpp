@@ -0,0 +1,44 @@
+/********************************************************************/
+/* Project: uwimageproc							*/
+/* Module: 	Videostrip						*/
+/* File: 	framering.cpp                                           */
+/* Created:		17/10/2026                                          */
+/* Description
+	Ring of preallocated frame buffers. Decoding into recycled slots removes the per-frame
+	allocations, and passing slot handles between stages removes the full resolution copies.
+*/
+/********************************************************************/
+
+#include "../include/framering.h"
+
+FrameRing::FrameRing(int nSlots, cv::Size frameSize, int type) : closed(false) {
+    slots.resize(std::max(1, nSlots));
+    for (size_t i = 0; i < slots.size(); i++) {
+        slots[i].id = (int) i;
+        slots[i].img.create(frameSize, type);
+        freeSlots.push_back((int) i);
+    }
+}
+
+std::shared_ptr<FrameSlot> FrameRing::acquire() {
+    std::unique_lock<std::mutex> lock(mtx);
+    freeCond.wait(lock, [this] { return closed || !freeSlots.empty(); });
+    if (closed) return std::shared_ptr<FrameSlot>();
+
+    FrameSlot *slot = &slots[freeSlots.back()];
+    freeSlots.pop_back();
+    // the slot is not deleted when the handle expires, it just returns to the ring
+    return std::shared_ptr<FrameSlot>(slot, [this](FrameSlot *s) { this->release(s); });
+}
+
+void FrameRing::close() {
+    std::lock_guard<std::mutex> lock(mtx);
+    closed = true;
+    freeCond.notify_all();
+}
+
+void FrameRing::release(FrameSlot *slot) {
+    std::lock_guard<std::mutex> lock(mtx);
+    freeSlots.push_back(slot->id);
+    freeCond.notify_one();
+}
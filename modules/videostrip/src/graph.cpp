@@ -0,0 +1,123 @@
+/********************************************************************/
+/* Project: uwimageproc							*/
+/* Module: 	Videostrip						*/
+/* File: 	graph.cpp                                               */
+/* Created:		17/10/2026                                          */
+/* Description
+	Binary sidecar with the features of the exported keyframes and the homographies between
+	neighbouring keyframes, so the mosaicking stage does not extract nor match them again.
+*/
+/********************************************************************/
+
+#include <cstring>
+
+#include "../include/graph.h"
+
+// the structures are read in place from a memory mapped file, so their layout is part of the format
+static_assert(sizeof(GraphHeader) == 88, "GraphHeader layout changed");
+static_assert(sizeof(GraphKeyframe) == 16, "GraphKeyframe layout changed");
+static_assert(sizeof(GraphKeypoint) == 24, "GraphKeypoint layout changed");
+static_assert(sizeof(GraphEdge) == 88, "GraphEdge layout changed");
+
+KeyframeGraph::KeyframeGraph(const string &filename, const string &featureType, float scale) :
+    file(filename.c_str(), std::ofstream::binary | std::ofstream::trunc),
+    features(FeatureBackend::create(featureType)) {
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "VSGRAPH", 8);
+    header.version = GRAPH_VERSION;
+    header.scale = scale;
+    std::strncpy(header.features, featureType.c_str(), sizeof(header.features) - 1);
+    // the header is rewritten by close(), once the size of every section is known
+    header.descriptorOffset = sizeof(GraphHeader);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+KeyframeGraph::~KeyframeGraph() {
+    close();
+}
+
+void KeyframeGraph::add(int id, int frame, const Mat &grey, const vector<KeyPoint> &keypoints, const Mat &descriptors) {
+    if (!valid()) return;
+    Node node;
+    node.id = id;
+    node.size = grey.size();
+    // keyframes selected while tracking with optical flow come without features
+    if (descriptors.empty()) features->detectAndCompute(grey, node.keypoints, node.descriptors);
+    else {
+        node.keypoints = keypoints;
+        node.descriptors = descriptors;
+    }
+    if (records.empty()) {
+        header.width = node.size.width;
+        header.height = node.size.height;
+    }
+
+    // descriptors are streamed, as rows of the same type for every keyframe
+    GraphKeyframe record;
+    record.id = id;
+    record.frame = frame;
+    record.firstKeypoint = (uint32_t) points.size();
+    record.nKeypoints = 0;
+    const Mat &d = node.descriptors;
+    if (!d.empty() && header.descriptorSize == 0) {
+        header.descriptorType = d.type();
+        header.descriptorSize = (uint32_t) (d.cols * d.elemSize());
+    }
+    if (!d.empty() && d.type() == (int) header.descriptorType && d.rows == (int) node.keypoints.size()) {
+        for (int r = 0; r < d.rows; r++) file.write(d.ptr<char>(r), header.descriptorSize);
+        for (size_t i = 0; i < node.keypoints.size(); i++) {
+            const KeyPoint &k = node.keypoints[i];
+            GraphKeypoint p = {k.pt.x, k.pt.y, k.size, k.angle, k.response, k.octave};
+            points.push_back(p);
+        }
+        record.nKeypoints = (uint32_t) node.keypoints.size();
+    }
+    records.push_back(record);
+
+    // neighbours along the transect, from the most recent one
+    for (std::deque<Node>::reverse_iterator prev = recent.rbegin(); prev != recent.rend(); ++prev) {
+        int nInliers = 0;
+        Mat H = matchHomography(node.keypoints, node.descriptors, prev->keypoints, prev->descriptors, *features, NULL, &nInliers);
+        if (H.empty()) continue;
+        float overlap = overlapArea(H, prev->size);
+        if (overlap <= 0) continue;
+
+        GraphEdge edge;
+        edge.from = id;
+        edge.to = prev->id;
+        edge.overlap = overlap;
+        edge.inliers = nInliers;
+        for (int i = 0; i < 9; i++) edge.H[i] = H.at<double>(i / 3, i % 3);
+        links.push_back(edge);
+    }
+
+    recent.push_back(node);
+    if (recent.size() > GRAPH_WINDOW) recent.pop_front();
+}
+
+void KeyframeGraph::pad() {
+    static const char zeros[8] = {0};
+    long long position = (long long) file.tellp();
+    if (position % 8) file.write(zeros, 8 - position % 8);
+}
+
+bool KeyframeGraph::close() {
+    if (!file.is_open()) return false;
+    pad();
+    header.keyframeOffset = (uint64_t) file.tellp();
+    if (!records.empty()) file.write(reinterpret_cast<const char*>(&records[0]), records.size() * sizeof(GraphKeyframe));
+    header.keypointOffset = (uint64_t) file.tellp();
+    if (!points.empty()) file.write(reinterpret_cast<const char*>(&points[0]), points.size() * sizeof(GraphKeypoint));
+    header.edgeOffset = (uint64_t) file.tellp();
+    if (!links.empty()) file.write(reinterpret_cast<const char*>(&links[0]), links.size() * sizeof(GraphEdge));
+
+    header.nKeyframes = (uint32_t) records.size();
+    header.nKeypoints = (uint32_t) points.size();
+    header.nEdges = (uint32_t) links.size();
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    bool ok = file.good();
+    file.close();
+    recent.clear();
+    return ok;
+}
@@ -18,17 +18,20 @@
 
 #include "../include/videostrip.hpp"
 #include "../include/options.h"
+#include "../include/pipeline.h"
+#include "../include/exporter.h"
+#include "../include/selector.h"
+#include "../include/segments.h"
+#include "../include/batch.h"
+#include "../include/checkpoint.h"
+#include "../include/frameindex.h"
+#include "../include/graph.h"
 #include <ctime>
+#include <unistd.h>
+#include <thread>
 
 // #cmakedefine USE_GPU
 
-char keyboard = 0;	// keyboard input character
-double t;			// Timing monitor
-
-#if USE_GPU
-    GpuMat auxD;    // Auxilary GpuMat to keep track of descriptors
-#endif
-
 // General structure index:
 //**** 1- Parse arguments from CLI
 //**** 2- Read input file
@@ -41,12 +44,38 @@ double t;			// Timing monitor
 //****	5.4- Assign it as next keyframe
 //****	5.5 Repeat from 5
 
-// Video width and height
-int videoWidth, videoHeight;
-// Resize factor from original video frame size to desired TARGET_WIDTH or TARGET_HEIGHT
-// This is for fast motion estimation through homography. Perhaps some optical-flow approach could work faster
-// Image tiling may improve homography quality by forcing well-spread control points along the image (See CIRS paper)
-float hResizeFactor;
+/*!
+	@fn		void dumpMetrics(const string &prefix)
+	@brief	Writes the stage latencies and counters of the run as <prefix>videostrip_metrics.json and .csv
+*/
+static void dumpMetrics(const string &prefix) {
+    string jsonName = prefix + "videostrip_metrics.json";
+    string csvName = prefix + "videostrip_metrics.csv";
+    if (writeMetricsJSON(jsonName) && writeMetricsCSV(csvName))
+        cout << green << "Metrics written to: " << reset << jsonName << ", " << csvName << endl;
+    else
+        cerr << red << "Unable to write metrics to: " << jsonName << reset << endl;
+}
+
+/*!
+	@fn		bool writeCheckpoint(Checkpoint &checkpoint, const string &filename, const KeyframeSelector &selector, int keyframeIndex,
+	                             int position, int outputCounter, KeyframeExporter &exporter, ofstream &reportFile)
+	@brief	Waits for the pending keyframes to be written, and saves the state of the selection as a checkpoint
+*/
+static bool writeCheckpoint(Checkpoint &checkpoint, const string &filename, const KeyframeSelector &selector, int keyframeIndex,
+                            int position, int outputCounter, KeyframeExporter &exporter, ofstream &reportFile) {
+    // every keyframe listed in the report must be on disk, as a resumed run will not write it again
+    exporter.flush();
+    reportFile.flush();
+    checkpoint.position = position;
+    checkpoint.outputCounter = outputCounter;
+    checkpoint.reportOffset = (double) reportFile.tellp();
+    checkpoint.keyframeIndex = keyframeIndex;
+    checkpoint.grey = selector.current().grey;
+    checkpoint.keypoints = selector.current().keypoints;
+    checkpoint.descriptors = selector.current().descriptors;
+    return saveCheckpoint(filename, checkpoint);
+}
 
 /*!
 	@fn		int main(int argc, char* argv[])
@@ -90,6 +119,7 @@ int main(int argc, char *argv[]) {
     }
 
     int CUDA = 0;                                       //Default option (running with CPU)
+    char keyboard = 0;	// keyboard input character
 
 #ifdef USE_GPU
     cout << green << "CUDA mode enabled" << reset << std::endl;
@@ -98,20 +128,21 @@ int main(int argc, char *argv[]) {
      * Start parsing mandatory arguments
      */
 
-    if (!argInput){
+    if (!argInput && !argBatch){
         cerr << "Mandatory <input> file name missing" << endl;
         cerr << "Use -h, --help command to see usage" << endl;
         return 1;
     }
 
-    if (!argOutput){
+    // in batch mode, the only positional argument is the output prefix
+    if (!argOutput && !(argBatch && argInput)){
         cerr << "Mandatory <output> file name missing" << endl;
         cerr << "Use -h, --help command to see usage" << endl;
         return 1;
     }
 
-    String InputFile = args::get(argInput);	//String containing the input file path+name from cvParser function
-    String OutputFile = args::get(argOutput);	//String containing the output file template from cvParser function
+    String InputFile = (argInput && argOutput) ? args::get(argInput) : "";	//String containing the input file path+name from cvParser function
+    String OutputFile = argOutput ? args::get(argOutput) : args::get(argInput);	//String containing the output file template from cvParser function
     ostringstream OutputFileName;				// output string that will contain the desired output file name
 
 	/*
@@ -119,7 +150,12 @@ int main(int argc, char *argv[]) {
 	 */
     ofstream reportFile;
     String reportFileName = OutputFile + "videostrip_report.txt";
-    reportFile.open(reportFileName, std::ofstream::out);
+    // a resumed run keeps the report of the interrupted one, it is reopened once the checkpoint is validated
+    Checkpoint checkpoint;
+    String checkpointName = checkpointFileName(OutputFile);
+    bool resuming = argResume && !argBatch && loadCheckpoint(checkpointName, checkpoint);
+    // in batch mode, every video writes its own report
+    if (!argBatch && !resuming) reportFile.open(reportFileName, std::ofstream::out);
 
     reportFile << "videostrip" << endl;
     reportFile << "\tOpenCV version:\t" << CV_VERSION  << endl;
@@ -133,6 +169,21 @@ int main(int argc, char *argv[]) {
     int timeSkip = DEFAULT_TIMESKIP;	// number of seconds to skip from the start of the video
     int kWindow = DEFAULT_KWINDOW;		// size of the search window for the best frame
     float minOverlap = OVERLAP_MIN;	    // desired minOverlap percentage between frames
+    int nThreads = std::max(1, (int) std::thread::hardware_concurrency() - 1);	// analysis workers, leave one core for decoding
+    string exportFormat = DEFAULT_EXPORT_FORMAT;	// output image format for the keyframes
+    int exportQuality = -1;		// JPEG quality or PNG compression. Negative: encoder default
+    int exportWorkers = DEFAULT_EXPORT_WORKERS;	// threads writing keyframes to disk
+    string featureType = DEFAULT_FEATURES;	// feature detector/descriptor used to estimate the overlap
+    string estimator = "features";		// overlap estimator: descriptor matching on every frame, or optical flow tracking
+    bool adaptive = false;		// skip frames while the predicted overlap is far from minOverlap
+    int nSegments = 1;			// time segments processed in parallel, each one with its own capture
+    bool lumaOnly = false;		// analysis runs on the luma plane delivered by the decoder, without colour conversion
+    double checkpointPeriod = CHECKPOINT_PERIOD;	// seconds between checkpoints of a single mode run (0: disabled)
+#ifdef HEADLESS
+    bool headless = true;		// built without HighGUI: there is no keyboard to poll
+#else
+    bool headless = false;		// unattended run, stopped by SIGINT/SIGTERM instead of 'q'/ESC
+#endif
 
     /*
      * Now, start verifying each optional argument from argParser
@@ -153,6 +204,140 @@ int main(int argc, char *argv[]) {
     else
         cout << "[minOverlap] using default value: " << minOverlap << endl;
 
+    if (argThreads)
+        cout << "[threads] value provided: " << (nThreads = std::max(1, args::get(argThreads))) << endl;
+    else
+        cout << "[threads] using default value: " << nThreads << endl;
+
+    if (argFeatures)
+        cout << "[features] value provided: " << (featureType = args::get(argFeatures)) << endl;
+    else
+        cout << "[features] using default value: " << featureType << endl;
+
+    // matching runs here, in the selection loop. Each analysis worker creates its own backend for detection
+    Ptr<FeatureBackend> features = FeatureBackend::create(featureType);
+    if (features.empty()) {
+        cerr << red << "Unsupported feature type: " << featureType << reset << endl;
+        cerr << "Valid options are: " << FeatureBackend::available() << endl;
+        return 1;
+    }
+
+    if (argEstimator)
+        cout << "[estimator] value provided: " << (estimator = args::get(argEstimator)) << endl;
+    else
+        cout << "[estimator] using default value: " << estimator << endl;
+
+    if (estimator != "features" && estimator != "flow") {
+        cerr << red << "Unsupported overlap estimator: " << estimator << reset << endl;
+        cerr << "Valid options are: features, flow" << endl;
+        return 1;
+    }
+    bool useFlow = (estimator == "flow");
+
+    if (argAdaptive) {
+        adaptive = true;
+        cout << "[adaptive] enabled, skipping frames up to: " << SKIP_MAX_FRAMES << endl;
+    }
+
+    if (argLuma) {
+        lumaOnly = true;
+        cout << "[luma] enabled, colour is only recovered for exported frames" << endl;
+    }
+
+    if (argSegments)
+        cout << "[segments] value provided: " << (nSegments = std::max(1, args::get(argSegments))) << endl;
+    else
+        cout << "[segments] using default value: " << nSegments << endl;
+
+    // checkpoints hold the state of a single keyframe chain: batch and segmented runs are restarted from scratch
+    if (argResume && (argBatch || nSegments > 1)) {
+        cerr << red << "--resume is only supported in single mode (without -b/--batch or -n/--segments)" << reset << endl;
+        return 1;
+    }
+
+    // the graph is rebuilt from the first keyframe of the run: a resumed run would overwrite the keyframes written before
+    if (argGraph && argResume) {
+        cerr << red << "--graph can not be combined with --resume, run the whole video again to build the graph" << reset << endl;
+        return 1;
+    }
+
+    if (argGraph && (argBatch || nSegments > 1))
+        cout << yellow << "[graph] the keyframe graph is only written in single mode, ignored" << reset << endl;
+
+    if (argCheckpoint)
+        cout << "[checkpoint] value provided: " << (checkpointPeriod = std::max(0.0, args::get(argCheckpoint))) << endl;
+    else
+        cout << "[checkpoint] using default value: " << checkpointPeriod << endl;
+
+    if (resuming)
+        cout << "[resume] resuming from: " << checkpointName << endl;
+    else if (argResume)
+        cout << yellow << "[resume] no checkpoint found in: " << checkpointName << ", starting from the beginning" << reset << endl;
+
+    if (argFormat)
+        cout << "[format] value provided: " << (exportFormat = args::get(argFormat)) << endl;
+    else
+        cout << "[format] using default value: " << exportFormat << endl;
+
+    if (argQuality)
+        cout << "[quality] value provided: " << (exportQuality = args::get(argQuality)) << endl;
+
+    if (argWriters)
+        cout << "[writers] value provided: " << (exportWorkers = std::max(1, args::get(argWriters))) << endl;
+    else
+        cout << "[writers] using default value: " << exportWorkers << endl;
+
+    Ptr<FrameEncoder> encoder = createEncoder(exportFormat, exportQuality);
+    if (encoder.empty()) {
+        cerr << red << "Unsupported output format: " << exportFormat << reset << endl;
+        cerr << "Valid options are: jpg, png, ppm" << endl;
+        return 1;
+    }
+
+    if (argHeadless) headless = true;
+    if (headless)
+        cout << "[headless] enabled, stop with SIGINT/SIGTERM" << endl;
+
+    // SIGINT/SIGTERM stop the run as 'q'/ESC does: pending keyframes are still written, and the report closed
+    installStopHandler();
+    StatusFile status(argStatus ? args::get(argStatus) : "", "videostrip");
+    if (status.enabled())
+        cout << "[status] progress written to: " << args::get(argStatus) << endl;
+
+    //**************************************************************************
+    /* BATCH MODE */
+    // every video in the directory is processed by a pool of workers, each one with its own selector and prefix
+    if (argBatch) {
+        BatchSettings settings;
+        settings.prefix = OutputFile;
+        settings.nWorkers = nThreads;
+        settings.exportWorkers = exportWorkers;
+        settings.timeSkip = timeSkip;
+        settings.useIndex = !argNoIndex;
+        settings.lumaOnly = lumaOnly;
+        settings.selection.minOverlap = minOverlap;
+        settings.selection.kWindow = kWindow;
+        settings.selection.featureType = features->name();
+        settings.selection.useFlow = useFlow;
+        settings.selection.adaptive = adaptive;
+
+        cout << "[batch] processing videos in: " << args::get(argBatch) << endl;
+        KeyframeExporter exporter(encoder, exportWorkers, DEFAULT_QUEUE_SIZE);
+        status.set("input", args::get(argBatch));
+        int nFailed = processBatch(args::get(argBatch), settings, exporter, status);
+        exporter.close();
+        status.set("failed_writes", exporter.failures());
+        status.update(nFailed < 0 ? "failed" : stopRequested() ? "stopped" : "done", true);
+        if (nFailed < 0)
+            cerr << red << "No video files found in: " << args::get(argBatch) << reset << endl;
+        else if (nFailed > 0)
+            cerr << red << nFailed << " videos could not be processed" << reset << endl;
+        if (exporter.failures() > 0)
+            cerr << red << exporter.failures() << " keyframes could not be written" << reset << endl;
+        if (argMetrics) dumpMetrics(OutputFile);
+        return (nFailed == 0) ? 0 : 1;
+    }
+
     if (argReport)
         cout << "[reportFlag] detailed output report will be exported to: " << reportFileName << endl;
     else
@@ -232,14 +417,17 @@ int main(int argc, char *argv[]) {
     if (! capture.isOpened()) {
         //error while opening the video input
         cout << red << "Unable to open video file: " << InputFile << endl;
+        status.update("failed", true);
         exit(EXIT_FAILURE);
     }
     //now we retrieve and print info about input video
-    videoWidth = capture.get(CV_CAP_PROP_FRAME_WIDTH);
-    videoHeight = capture.get(CV_CAP_PROP_FRAME_HEIGHT);
+    int videoWidth = capture.get(CV_CAP_PROP_FRAME_WIDTH);
+    int videoHeight = capture.get(CV_CAP_PROP_FRAME_HEIGHT);
 
     // we compute the resize factor for the horizontal dimension. As we preserve the aspect ratio, is the same for the vertical resizing
-    hResizeFactor = (float) TARGET_WIDTH / videoWidth;
+    // This is for fast motion estimation through homography. Image tiling may improve homography quality by forcing
+    // well-spread control points along the image (See CIRS paper)
+    float hResizeFactor = (float) TARGET_WIDTH / videoWidth;
 
     float videoFPS = capture.get(CV_CAP_PROP_FPS);
     int videoFrames = capture.get(CV_CAP_PROP_FRAME_COUNT);
@@ -250,6 +438,12 @@ int main(int argc, char *argv[]) {
     cout << "\thResize:\t" << hResizeFactor << endl;
     cout << "Target minOverlap:\t" << minOverlap << endl;
     cout << "Window size:\t" << kWindow << endl;
+    cout << "Analysis threads:\t" << nThreads << endl;
+    cout << "Features:\t" << features->name() << endl;
+    cout << "Estimator:\t" << estimator << endl;
+    cout << "Adaptive sampling:\t" << (adaptive ? "on" : "off") << endl;
+    cout << "Luma only:\t" << (lumaOnly ? "on" : "off") << endl;
+    cout << "Segments:\t" << nSegments << endl;
 	if (timeSkip > 0) cout << "Time skip:\t" << timeSkip << endl;
 
     reportFile << "Video metadata:" << endl;
@@ -258,143 +452,269 @@ int main(int argc, char *argv[]) {
     reportFile << "\thResize:\t" << hResizeFactor << endl;
     reportFile << "Target minOverlap:\t" << minOverlap << endl;
     reportFile << "Window size:\t" << kWindow << endl;
+    reportFile << "Features:\t" << features->name() << endl;
+    reportFile << "Estimator:\t" << estimator << endl;
+    reportFile << "Adaptive sampling:\t" << (adaptive ? "on" : "off") << endl;
+    reportFile << "Luma only:\t" << (lumaOnly ? "on" : "off") << endl;
+    reportFile << "Segments:\t" << nSegments << endl;
 	if (timeSkip > 0) reportFile << "Time skip:\t" << timeSkip << endl;
     reportFile << "***************************************" << endl;
     reportFile << "ID\tFrame\tFilename\tOverlap\tBlur" << endl;
 
-	//we compute the (exact) number of frames to be skipped, given a desired amount of seconds to skip from start
-	float frameSkip;
-	if (timeSkip > 0){
-		frameSkip = (float)timeSkip * videoFrames;
-		capture.set(CV_CAP_PROP_POS_MSEC, timeSkip*1000);
-	}
+    // every seek (--timeSkip, --resume, segments, colour recovery in luma mode) goes through the frame index of the
+    // video, built on first use and cached next to it. Without it, the backend seeks by timestamp, and the frames are
+    // numbered from its position
+    FrameIndex index;
+    if (!argNoIndex && (timeSkip > 0 || resuming || nSegments > 1 || lumaOnly) && !index.open(InputFile))
+        cout << yellow << "Unable to index the video, seeking by timestamp" << reset << endl;
+
+    //we compute the (exact) number of frames to be skipped, given a desired amount of seconds to skip from start
+    int frameSkip = -1;     // negative: frames are numbered from the position reported by the capture
+    if (timeSkip > 0){
+        if (!index.empty()) frameSkip = index.frameAt(timeSkip * 1000.0);
+        if (frameSkip < 0 || !index.seek(capture, frameSkip)) {
+            capture.set(CV_CAP_PROP_POS_MSEC, timeSkip*1000);
+            frameSkip = -1;
+        }
+    }
+
+    //**************************************************************************
+    /* RESUME */
+    // the report is truncated after the last keyframe of the checkpoint, and the video seeked to the next frame to analyse
+    if (resuming) {
+        if (checkpoint.videoFrames != videoFrames || checkpoint.frameSize != Size(videoWidth, videoHeight)
+                || checkpoint.featureType != features->name()) {
+            cerr << red << "Checkpoint does not match the input video or the feature type: " << checkpointName << reset << endl;
+            status.update("failed", true);
+            return 1;
+        }
+        if (checkpoint.input != InputFile)
+            cout << yellow << "Checkpoint was written for: " << checkpoint.input << reset << endl;
+        if (truncate(reportFileName.c_str(), (off_t) checkpoint.reportOffset) != 0) {
+            cerr << red << "Unable to restore the report: " << reportFileName << reset << endl;
+            status.update("failed", true);
+            return 1;
+        }
+        reportFile.clear();     // the header was not written, the interrupted run already did
+        reportFile.open(reportFileName, std::ofstream::out | std::ofstream::app);
+        if (!index.seek(capture, checkpoint.position)) capture.set(CAP_PROP_POS_FRAMES, checkpoint.position);
+        frameSkip = checkpoint.position;
+        cout << green << "Resuming from frame: " << reset << checkpoint.position << " (keyframe " << checkpoint.keyframeIndex
+             << ", " << checkpoint.outputCounter << " frames exported)" << endl;
+    }
+    checkpoint.input = InputFile;
+    checkpoint.videoFrames = videoFrames;
+    checkpoint.frameSize = Size(videoWidth, videoHeight);
+    checkpoint.featureType = features->name();
+
+    // Selection parameters, shared by the single and the segmented modes
+    SelectorSettings selection;
+    selection.minOverlap = minOverlap;
+    selection.kWindow = kWindow;
+    selection.featureType = features->name();
+    selection.useFlow = useFlow;
+    selection.adaptive = adaptive;
+    selection.useGPU = (CUDA != 0);
+    selection.resizeFactor = hResizeFactor;
+
+    //**************************************************************************
+    /* SEGMENTED PROCESSING */
+    // The video is split in time segments, each one processed by its own thread, capture and keyframe chain.
+    // The analysis threads are shared among the segments
+    if (nSegments > 1) {
+        SegmentSettings settings;
+        settings.input = InputFile;
+        settings.prefix = OutputFile;
+        settings.frameSize = Size(videoWidth, videoHeight);
+        settings.fps = videoFPS;
+        settings.nWorkers = std::max(1, nThreads / nSegments);
+        settings.exportWorkers = exportWorkers;
+        settings.lumaOnly = lumaOnly;
+        settings.selection = selection;
+        settings.index = index.empty() ? NULL : &index;
+
+        int firstFrame = (frameSkip >= 0) ? frameSkip : std::max(0, (int) capture.get(CAP_PROP_POS_FRAMES));
+        capture.release();      // every segment opens its own capture
+
+        KeyframeExporter exporter(encoder, exportWorkers, DEFAULT_QUEUE_SIZE);
+        status.set("input", InputFile);
+        // the container may overestimate the frame count, which would leave the last segments past the end
+        int nFrames = index.empty() ? videoFrames : index.frames();
+        int nKeyframes = processSegmented(settings, nSegments, firstFrame, nFrames, exporter, reportFile, status);
+        exporter.close();
+        status.set("keyframes", std::max(nKeyframes, 0));
+        status.set("failed_writes", exporter.failures());
+        status.update(nKeyframes < 0 ? "failed" : stopRequested() ? "stopped" : "done", true);
+        if (exporter.failures() > 0)
+            cerr << red << exporter.failures() << " keyframes could not be written" << reset << endl;
+        if (nKeyframes >= 0)
+            cout << green << "Exported frames: " << reset << nKeyframes << endl;
+        reportFile.close();
+        if (argMetrics) dumpMetrics(OutputFile);
+        return (nKeyframes < 0) ? 1 : 0;
+    }
 
     //**************************************************************************
     /* PROCESS START */
-    // Next, we start reading frames from the input video
-    Mat frame(videoWidth, videoHeight, CV_8UC1);
-    Mat bestframe, res_frame;
-    // struct keyframe
-    keyframe kframe; 
-    
-    float currOverlap;	//current overlap value
-    int out_frame = 0, read_frame = 0;	//frame counters
-
-    // we use the first frame as keyframe (so far, further implementations should include cli arg to pick one by user)
-    capture.read(kframe.img);    read_frame ++;
-    kframe.new_img = true;
-    // resizing for speed purposes
-    resize(kframe.img, kframe.res_img, cv::Size(hResizeFactor * kframe.img.cols, hResizeFactor * kframe.img.rows), 0, 0,
-           CV_INTER_LINEAR);
-    // TODO: This second way to call 'resize' may be faster
-    //resize(frame, res_frame, cv::Size(), hResizeFactor, hResizeFactor);
-
-    // we save the first keyframe. Using zero padding up to 4 digits for output frames enumeration
-    OutputFileName.str("");
-    OutputFileName << OutputFile << setfill('0') << setw(4) << out_frame << ".jpg";
-    imwrite(OutputFileName.str(), kframe.img);
-//    reportFile << "ID\tFrame\tFilename\tOverlap\tBlur" << endl;
-    reportFile << "0\t0\t" << OutputFileName.str() << "\t" << "0.0\t0.0" << endl;
-
-    // exits when pressed 'ESC' or 'q'
-    while (keyboard != 'q' && keyboard != 27) {
-        t = (double) getTickCount();
-        //read the current frame, if fails, the quit
-        if (!capture.read(frame)) {
-            cerr << "\nUnable to read next frame." << endl;
-            cerr << "Exiting..." << endl;
-            exit(EXIT_FAILURE);
+    // Frames are decoded and analysed (resize, features, blur) in background threads, and delivered here in order.
+    // Only the matching against the current keyframe is done by the selector, as it depends on previous decisions.
+    // When tracking with optical flow, workers skip the feature extraction, as it is only needed to recover lost tracks
+    PipelineOptions pipelineOptions;
+    pipelineOptions.nWorkers = nThreads;
+    pipelineOptions.queueSize = DEFAULT_QUEUE_SIZE;
+    pipelineOptions.resizeFactor = hResizeFactor;
+    pipelineOptions.featureType = features->name();
+    pipelineOptions.detectFeatures = !useFlow;
+    pipelineOptions.lumaOnly = lumaOnly;
+
+    // Frame buffers are allocated once: the refinement window, plus the frames being analysed and written, plus the
+    // current keyframe, best candidate, the last frame tracked by optical flow and the frame being decoded.
+    // Declared first, as every other stage uses its slots
+    FrameRing ring(kWindow + nThreads + exportWorkers + 4, Size(videoWidth, videoHeight), lumaOnly ? CV_8UC1 : CV_8UC3);
+    FramePipeline pipeline(capture, ring, pipelineOptions);
+    // in luma mode, the colour of the exported frames is converted from the YUV planes or decoded again
+    ColourRecovery recovery(InputFile, &index);
+    if (lumaOnly && !pipeline.rawFrames())
+        cout << yellow << "The video backend does not support raw frames, decoding in colour" << reset << endl;
+    KeyframeExporter exporter(encoder, exportWorkers, DEFAULT_QUEUE_SIZE);
+    KeyframeSelector selector(selection);
+    FramePacket packet;
+    SelectedKeyframe selected;
+    // features and match graph of the exported keyframes, for the mosaicking stage
+    String graphFileName = OutputFile + "videostrip_graph.bin";
+    Ptr<KeyframeGraph> graph;
+    if (argGraph) {
+        graph = Ptr<KeyframeGraph>(new KeyframeGraph(graphFileName, features->name(), hResizeFactor));
+        if (!graph->valid()) {
+            cerr << red << "Unable to write keyframe graph: " << graphFileName << reset << endl;
+            graph.release();
         }
-        read_frame++;	//successfully read a new frame, we continue...
+    }
 
-        float bestBlur = 0.0, currBlur;    //we start using the current frame blur as best blur value
-        resize(frame, res_frame, cv::Size(), hResizeFactor, hResizeFactor);
-    #if USE_GPU
-        if(CUDA) currOverlap = calcOverlapGPU(&kframe, res_frame);
-    #endif
-        if(not CUDA) currOverlap = calcOverlap(&kframe, res_frame);
-
-        cout << '\r' << yellow << "Frame: " << reset << (read_frame - 1) << "\tOverlap: " << currOverlap << std::flush;
-
-	//special case: minOverlap cannot be computed, we force it with an impossible negative value
-        // TODO: check better numerically stable way to detect failed minOverlap detection, rather than using a forced value
-		if (currOverlap == -2.0){
-            /*cout << endl << "Forcing current new keyframe" << endl;
-			keyframe = frame.clone();		
-	        resize(keyframe, res_keyframe, cv::Size(), hResizeFactor, hResizeFactor);*/
-			currOverlap = OVERLAP_MIN + 0.01;	//by doing this, we may trigger a new keyframe 
-		}
-		// should we trigger a new keyframe search? TODO: improve this conditional
-//		if ((currOverlap <= minOverlap) && (currOverlap > OVERLAP_MIN)) {
-		if ((currOverlap <= minOverlap)) {
-			cout << endl;
-            /*!
-            Start to search best frames in i+k frames, according to "blur level" estimator (based on Laplacian variance)
-            We start using current frame as best frame so far
-            */
-        #if USE_GPU
-            if(CUDA) bestBlur = calcBlurGPU(res_frame);
-        #endif
-            if(not CUDA) bestBlur = calcBlur(res_frame);
-
-            int best_frame_number = capture.get(CAP_PROP_POS_FRAMES) - 1;
-            bestframe = frame.clone();	// we copy this new frame as the best frame
-
-            //for each frame inside the k-consecutive frame window, we refine the search
-            for (int n = 0; n < kWindow; n ++) {
-
-				if (! capture.read(frame)) {
-				    cerr << endl << "Unable to read next frame." << endl;
-				    cerr << "Ending..." << endl;
-				    exit(EXIT_FAILURE);
-				}
-                read_frame ++;	//we read another frame
-                resize(frame, res_frame, cv::Size(), hResizeFactor, hResizeFactor);    //uses a resized version
-
-                //we operate over the resampled image for speed purposes
-            #if USE_GPU
-                if(CUDA) currBlur = calcBlurGPU(res_frame);
-            #endif
-                if(not CUDA) currBlur = calcBlur(res_frame);    
-
-                cout << '\r' << "Refining search [" << n+1 << "/" << kWindow << "]\tBlur: " << currBlur << "\tBest: " << bestBlur << std::flush;
-                if (currBlur > bestBlur) {    //if current blur is better, replaces best frame
-                    bestBlur = currBlur;
-                    bestframe = frame.clone();  //best frame is a copy of frame
-            		best_frame_number = read_frame;
-                }
+    int nFrames = 0;	//processed frames counter
+    int out_frame = 0;	//exported frames counter
+    int keyframeIndex = -1;	// frame number of the current keyframe
+    if (resuming) {
+        // the keyframe of the checkpoint was already exported, it is only used to measure the overlap of the next frames
+        FramePacket key = makePacket(checkpoint.grey, checkpoint.keyframeIndex, 1.0);
+        key.keypoints = checkpoint.keypoints;
+        key.descriptors = checkpoint.descriptors;
+        selector.resume(key);
+        keyframeIndex = checkpoint.keyframeIndex;
+        out_frame = checkpoint.outputCounter;
+    }
+    double tStart = (double) getTickCount();
+    double tCheckpoint = tStart;
+    status.set("input", InputFile);
+    status.set("frames", videoFrames);
+    status.update("running", true);
+
+    pipeline.start(frameSkip);
+    // exits when pressed 'ESC' or 'q', or on SIGINT/SIGTERM
+    while (keyboard != 'q' && keyboard != 27 && !stopRequested()) {
+        //get the current (already analysed) frame, if fails, the quit
+        if (!pipeline.next(packet)) {
+            if (nFrames == 0 && !resuming) {
+                cout << red << "Unable to read first frame from: " << InputFile << reset << endl;
+                status.update("failed", true);
+                exit(EXIT_FAILURE);
             }
-            //< finally the new keyframe is the best frame from last iteration
-            kframe.img = bestframe.clone();
-            kframe.new_img = true;
+            cerr << "\nUnable to read next frame." << endl;
+            cerr << "Exiting..." << endl;
+            break;
+        }
+        nFrames++;
+
+        // the first frame is used as keyframe. Then, once the overlap falls below minOverlap, the best frame (according to
+        // its "blur level", based on Laplacian variance) among the next kWindow frames is selected as the new keyframe
+        selector.push(packet);
+        if (selector.measured())
+            cout << '\r' << yellow << "Frame: " << reset << packet.index << "\tOverlap: " << selector.overlap() << std::flush;
+        else if (selector.windowPosition() > 0)
+            cout << '\r' << "Refining search [" << selector.windowPosition() << "/" << kWindow << "]\tBlur: " << packet.blur
+                 << "\tBest: " << selector.bestBlur() << std::flush;
+
+        // far from minOverlap, the frames predicted to keep a larger overlap are grabbed without being decoded.
+        // The keyframe is still triggered by a measured overlap, so the -p threshold keeps its meaning
+        if (selector.skip() > 0) pipeline.skipTo(packet.index + selector.skip() + 1);
+
+        while (selector.pull(selected)) {
+            // Using zero padding up to 4 digits for output frames enumeration
+            // The exporter appends the extension of the selected format and writes it in background
+            OutputFileName.str("");
+            OutputFileName << OutputFile << setfill('0') << setw(4) << out_frame;
+            string exportedName = exporter.write(OutputFileName.str(), recovery.recover(selected.packet), selected.packet.slot);
+            if (out_frame > 0)
+                cout << endl << green << "Exported frame: " << reset << selected.packet.index << " [" << out_frame << "]" << endl;
+            reportFile << out_frame << "\t" << selected.packet.index << "\t" << exportedName << "\t" << selected.overlap << "\t" << selected.blur << endl;
+            if (graph) graph->add(out_frame, selected.packet.index, selected.packet.grey(), selected.packet.keypoints, selected.packet.descriptors);
+            keyframeIndex = selected.packet.index;
             out_frame++;	//increase the number of frames exported
+            selected = SelectedKeyframe();	// the slot goes back to the ring once written
+            if (out_frame > 1) cout << "*************" << endl;
+        }
 
-            OutputFileName.str("");
-            OutputFileName << OutputFile << setfill('0') << setw(4) << out_frame << ".jpg";
-
-//           int current_frame = capture.get(CAP_PROP_POS_FRAMES) - 1; //returns next frame number to be retrieved 
-//			cout << endl << "frame:\t" << cyan <<  current_frame << reset << endl;
-//			cout << "out_frame:\t" << yellow << out_frame << reset << endl;
-//			cout << "best_frame:\t" << red << best_frame_number << reset << endl;
-            imwrite(OutputFileName.str(), bestframe);
-            cout << endl << green << "Exported frame: " << reset << best_frame_number << " [" << out_frame << "]" << endl;
-		    reportFile << out_frame << "\t" << best_frame_number << "\t" << OutputFileName.str() <<"\t" << currOverlap << "\t" << bestBlur << endl;
-
-            #ifdef _VERBOSE_ON_
-                t = 1000 * ((double) getTickCount() - t) / getTickFrequency();
-                cout << endl << "BestBlur: " << t << " ms" << endl;
-                t = (double) getTickCount();
-            #endif
-            resize(kframe.img, kframe.res_img, cv::Size(), hResizeFactor, hResizeFactor);
-			cout << "*************" << endl;
+        // progress for external monitors. Only written once per STATUS_PERIOD
+        if (status.enabled()) {
+            double elapsed = ((double) getTickCount() - tStart) / getTickFrequency();
+            status.set("frame", packet.index);
+            status.set("analysed", nFrames);
+            status.set("keyframes", out_frame);
+            status.set("fps", nFrames / std::max(elapsed, 1e-3));
+            status.update("running");
+        }
+
+        // checkpoints are only taken between refinement windows, so the current keyframe is the last one exported
+        if (checkpointPeriod > 0 && !selector.refining()
+                && ((double) getTickCount() - tCheckpoint) / getTickFrequency() >= checkpointPeriod) {
+            if (!writeCheckpoint(checkpoint, checkpointName, selector, keyframeIndex, packet.index + 1, out_frame, exporter, reportFile))
+                cerr << endl << red << "Unable to write checkpoint: " << checkpointName << reset << endl;
+            tCheckpoint = (double) getTickCount();
         }
 
-        //get the input from the keyboard
-        keyboard = (char) waitKey(5);
+    #ifndef HEADLESS
+        //get the input from the keyboard. Headless runs skip it, as waitKey() sleeps for its whole timeout
+        if (!headless) keyboard = (char) waitKey(1);
+    #endif
+    }
+    bool interrupted = stopRequested() || keyboard == 'q' || keyboard == 27;
+    if (stopRequested()) cout << endl << yellow << "Stop requested, finishing..." << reset << endl;
+    // an interrupted run can be resumed from where it stopped (or from the last checkpoint, if stopped while refining).
+    // Once the whole video was processed, the checkpoint is no longer needed
+    if (checkpointPeriod > 0 && interrupted && nFrames > 0 && !selector.refining()) {
+        if (writeCheckpoint(checkpoint, checkpointName, selector, keyframeIndex, packet.index + 1, out_frame, exporter, reportFile))
+            cout << "Checkpoint written to: " << checkpointName << endl;
+    }
+    else if (!interrupted)
+        std::remove(checkpointName.c_str());
+    // stop decoding/analysis, and wait for pending keyframes to be written (also when leaving with 'q' or ESC)
+    pipeline.stop();
+    if (adaptive) {
+        cout << endl << "Frames skipped without decoding:\t" << pipeline.grabbed() << endl;
+        reportFile << "Skipped frames:\t" << pipeline.grabbed() << endl;
+    }
+    if (recovery.decoded() > 0) {
+        cout << endl << "Keyframes decoded again in colour:\t" << recovery.decoded() << endl;
+        reportFile << "Colour recovered frames:\t" << recovery.decoded() << endl;
+    }
+    cout << endl << "Writing pending keyframes..." << endl;
+    exporter.close();
+    if (exporter.failures() > 0)
+        cerr << red << exporter.failures() << " keyframes could not be written" << reset << endl;
+    status.set("keyframes", out_frame);
+    status.set("failed_writes", exporter.failures());
+    if (graph) {
+        if (graph->close())
+            cout << green << "Keyframe graph written to: " << reset << graphFileName << " (" << graph->keyframes() << " keyframes, "
+                 << graph->edges() << " edges)" << endl;
+        else
+            cerr << red << "Unable to write keyframe graph: " << graphFileName << reset << endl;
     }
+    status.update(interrupted ? "stopped" : "done", true);
     //delete capture object
     capture.release();
     reportFile.close();
+    if (argMetrics) dumpMetrics(OutputFile);
 //*****************************************************************************
     return 0;
 }
\ No newline at end of file
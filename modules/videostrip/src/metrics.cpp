@@ -0,0 +1,158 @@
+/********************************************************************/
+/* Project: uwimageproc							*/
+/* Module: 	Videostrip						*/
+/* File: 	metrics.cpp                                             */
+/* Created:		17/10/2026                                          */
+/* Description
+	Lock free latency histograms and counters for the hot paths of videostrip, and their
+	JSON/CSV reports.
+*/
+/********************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+#include "../include/metrics.h"
+
+static const int SUB_BUCKETS = 1 << METRIC_SUB_BITS;
+
+static const char *names[METRIC_COUNT] = {
+    "decode", "resize", "detect", "match", "homography", "overlap", "blur", "flow", "export",
+    "keypoints", "good_matches", "tracks"
+};
+
+static Histogram histograms[METRIC_COUNT];
+static std::atomic<bool> enabled(true);
+
+// position of the most significant bit (value > 0)
+static inline int msb(uint64_t value) {
+#if defined(__GNUC__)
+    return 63 - __builtin_clzll(value);
+#else
+    int p = 0;
+    while (value >>= 1) p++;
+    return p;
+#endif
+}
+
+Histogram::Histogram() {
+    reset();
+}
+
+int Histogram::bucket(uint64_t value) {
+    if (value < (uint64_t) SUB_BUCKETS) return (int) value;
+    // exponent selects the group of buckets, and the bits right after the leading one select the sub-bucket
+    int p = msb(value);
+    int index = (p - METRIC_SUB_BITS + 1) * SUB_BUCKETS + (int) ((value >> (p - METRIC_SUB_BITS)) & (SUB_BUCKETS - 1));
+    return std::min(index, METRIC_BUCKETS - 1);
+}
+
+uint64_t Histogram::bucketStart(int index) {
+    if (index < SUB_BUCKETS) return index;
+    int p = index / SUB_BUCKETS + METRIC_SUB_BITS - 1;
+    return (uint64_t) (SUB_BUCKETS + index % SUB_BUCKETS) << (p - METRIC_SUB_BITS);
+}
+
+void Histogram::record(uint64_t value) {
+    buckets[bucket(value)].fetch_add(1, std::memory_order_relaxed);
+    nSamples.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value, std::memory_order_relaxed);
+    uint64_t prev = maxValue.load(std::memory_order_relaxed);
+    while (value > prev && !maxValue.compare_exchange_weak(prev, value, std::memory_order_relaxed)) {}
+}
+
+double Histogram::percentile(double p) const {
+    uint64_t n = count();
+    if (n == 0) return 0;
+    uint64_t rank = std::max<uint64_t>(1, (uint64_t) std::ceil(p / 100.0 * n));
+    uint64_t seen = 0;
+    for (int i = 0; i < METRIC_BUCKETS; i++) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen < rank) continue;
+        double width = (double) (bucketStart(i + 1) - bucketStart(i));
+        return std::min(bucketStart(i) + width / 2, (double) maximum());
+    }
+    return (double) maximum();
+}
+
+void Histogram::reset() {
+    for (int i = 0; i < METRIC_BUCKETS; i++) buckets[i].store(0, std::memory_order_relaxed);
+    nSamples.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    maxValue.store(0, std::memory_order_relaxed);
+}
+
+Histogram &metric(Metric id) {
+    return histograms[id];
+}
+
+const char *metricName(Metric id) {
+    return names[id];
+}
+
+bool metricIsTime(Metric id) {
+    return id < METRIC_KEYPOINTS;
+}
+
+void setMetricsEnabled(bool enable) {
+    enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool metricsEnabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void resetMetrics() {
+    for (int i = 0; i < METRIC_COUNT; i++) histograms[i].reset();
+}
+
+// summary of a metric, in its report unit (ms for latencies)
+struct MetricSummary {
+    double mean, p50, p95, p99, max, total;
+};
+
+static MetricSummary summarize(Metric id) {
+    const Histogram &h = histograms[id];
+    double scale = metricIsTime(id) ? 1e-6 : 1.0;
+    MetricSummary s;
+    s.total = h.total() * scale;
+    s.mean = s.total / std::max<uint64_t>(1, h.count());
+    s.p50 = h.percentile(50) * scale;
+    s.p95 = h.percentile(95) * scale;
+    s.p99 = h.percentile(99) * scale;
+    s.max = h.maximum() * scale;
+    return s;
+}
+
+bool writeMetricsJSON(const std::string &filename) {
+    std::ofstream file(filename.c_str(), std::ofstream::out);
+    if (!file) return false;
+    file << "{\"metrics\": {";
+    bool first = true;
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        Metric id = (Metric) i;
+        if (histograms[id].count() == 0) continue;
+        MetricSummary s = summarize(id);
+        file << (first ? "" : ",") << "\n  \"" << names[id] << "\": {\"unit\": \"" << (metricIsTime(id) ? "ms" : "count")
+             << "\", \"count\": " << histograms[id].count() << ", \"mean\": " << s.mean << ", \"p50\": " << s.p50
+             << ", \"p95\": " << s.p95 << ", \"p99\": " << s.p99 << ", \"max\": " << s.max << ", \"total\": " << s.total << "}";
+        first = false;
+    }
+    file << "\n}}" << std::endl;
+    return file.good();
+}
+
+bool writeMetricsCSV(const std::string &filename) {
+    std::ofstream file(filename.c_str(), std::ofstream::out);
+    if (!file) return false;
+    file << "metric,unit,count,mean,p50,p95,p99,max,total" << std::endl;
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        Metric id = (Metric) i;
+        if (histograms[id].count() == 0) continue;
+        MetricSummary s = summarize(id);
+        file << names[id] << "," << (metricIsTime(id) ? "ms" : "count") << "," << histograms[id].count() << ","
+             << s.mean << "," << s.p50 << "," << s.p95 << "," << s.p99 << "," << s.max << "," << s.total << std::endl;
+    }
+    return file.good();
+}
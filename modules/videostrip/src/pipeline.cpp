@@ -0,0 +1,257 @@
+/********************************************************************/
+/* Project: uwimageproc							*/
+/* Module: 	Videostrip						*/
+/* File: 	pipeline.cpp                                            */
+/* Created:		17/10/2026                                          */
+/* Description
+	Decode and analysis stages for videostrip. Decoding runs on its own thread, while per-frame
+	analysis (resize, feature extraction and blur estimation) runs on a pool of workers. Analysed
+	frames are reordered before being handed to the keyframe selection loop.
+*/
+/********************************************************************/
+
+#include "../include/pipeline.h"
+#include "../include/frameindex.h"
+
+FramePipeline::FramePipeline(VideoCapture &capture, FrameRing &ring, const PipelineOptions &options) :
+    capture(capture),
+    ring(ring),
+    options(options),
+    nWorkers(std::max(1, options.nWorkers)),
+    capacity(std::max(1, options.queueSize)),
+    // backends that do not support it keep delivering BGR frames, and the analysis converts them as usual
+    raw(options.lumaOnly && capture.set(CAP_PROP_CONVERT_RGB, false)),
+    frameSize((int) capture.get(CAP_PROP_FRAME_WIDTH), (int) capture.get(CAP_PROP_FRAME_HEIGHT)),
+    decoded(capacity),
+    nextIndex(0),
+    skipIndex(0),
+    nGrabbed(0),
+    activeWorkers(0),
+    stopped(false) {
+}
+
+FramePipeline::~FramePipeline() {
+    stop();
+}
+
+void FramePipeline::start(int first) {
+    // frames are numbered from the current position of the capture (it may have been moved by --timeSkip)
+    nextIndex = (first >= 0) ? first : std::max(0, (int) capture.get(CAP_PROP_POS_FRAMES));
+    skipIndex = nextIndex;
+    stopped = false;
+    activeWorkers = nWorkers;
+
+    decoder = std::thread(&FramePipeline::decodeLoop, this, nextIndex);
+    for (int i = 0; i < nWorkers; i++)
+        workers.push_back(std::thread(&FramePipeline::analysisLoop, this));
+}
+
+bool FramePipeline::next(FramePacket &packet) {
+    std::unique_lock<std::mutex> lock(mtx);
+    // wait until the expected frame has been analysed, or until nobody is left to produce it
+    readyCond.wait(lock, [this] { return stopped || analysed.count(nextIndex) > 0 || activeWorkers == 0; });
+
+    std::map<int, FramePacket>::iterator it = analysed.find(nextIndex);
+    if (it == analysed.end()) return false;
+
+    packet = it->second;
+    analysed.erase(it);
+    nextIndex++;
+    spaceCond.notify_all();
+    return true;
+}
+
+void FramePipeline::skipTo(int index) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (index <= nextIndex) return;
+    skipIndex = index;
+    nextIndex = index;
+    // release the slots of the frames already analysed that are no longer needed
+    analysed.erase(analysed.begin(), analysed.lower_bound(index));
+    spaceCond.notify_all();
+}
+
+void FramePipeline::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopped = true;
+        readyCond.notify_all();
+        spaceCond.notify_all();
+    }
+    // unblock the decoder (full queue or no free slot) and the workers (empty queue)
+    ring.close();
+    decoded.close();
+    decoded.clear();
+
+    if (decoder.joinable()) decoder.join();
+    for (size_t i = 0; i < workers.size(); i++)
+        if (workers[i].joinable()) workers[i].join();
+    workers.clear();
+
+    std::lock_guard<std::mutex> lock(mtx);
+    analysed.clear();
+}
+
+void FramePipeline::decodeLoop(int index) {
+    FramePacket packet;
+    while (true) {
+        // frames to be skipped are just grabbed: the decoder advances without retrieving the image
+        if (index < skipIndex) {
+            if (!capture.grab()) break;
+            index++;
+            nGrabbed++;
+            continue;
+        }
+        // decode into a recycled buffer. Waits here when every slot is still in use downstream
+        packet.slot = ring.acquire();
+        if (!packet.slot) break;                        // pipeline was stopped
+        ScopedTimer decodeTimer(METRIC_DECODE);
+        if (!capture.read(packet.slot->img)) break;     // end of video (or unreadable frame)
+        decodeTimer.stop();
+        packet.slot->invalidate();                      // derived images still belong to the previous frame
+        packet.img = packet.slot->img;
+        packet.format = raw ? frameFormat(packet.img, frameSize) : FRAME_BGR;
+        packet.scale = options.resizeFactor;
+        packet.index = index++;
+        if (!decoded.push(packet)) break;               // pipeline was stopped
+    }
+    packet = FramePacket();     // return the last slot to the ring
+    decoded.close();
+}
+
+void FramePipeline::analysisLoop() {
+    // detectors are not shared among threads, each worker builds its own backend once
+    Ptr<FeatureBackend> features;
+    if (options.detectFeatures) features = FeatureBackend::create(options.featureType);
+    FramePacket packet;
+    while (decoded.pop(packet)) {
+        if (packet.index < skipIndex) {             // skipped while waiting in the queue
+            packet = FramePacket();
+            continue;
+        }
+        analyseFrame(packet, features.get());
+
+        std::unique_lock<std::mutex> lock(mtx);
+        // keep the reorder buffer bounded. The packet expected by next() is always accepted, so this cannot deadlock
+        spaceCond.wait(lock, [&] { return stopped || packet.index < nextIndex + capacity; });
+        if (stopped) break;
+        if (packet.index < nextIndex) {             // skipped while being analysed
+            packet = FramePacket();
+            continue;
+        }
+        analysed[packet.index] = packet;
+        readyCond.notify_all();
+    }
+    packet = FramePacket();
+
+    std::lock_guard<std::mutex> lock(mtx);
+    activeWorkers--;
+    readyCond.notify_all();
+}
+
+FrameFormat frameFormat(const Mat &raw, Size frameSize) {
+    if (raw.channels() == 3) return FRAME_BGR;
+    if (raw.channels() == 2) return FRAME_YUYV;
+    if (frameSize.height > 0 && raw.rows == frameSize.height * 3 / 2) return FRAME_I420;
+    return FRAME_LUMA;
+}
+
+const Mat &FramePacket::resized() const {
+    // the slot buffers keep their allocation, so once the ring is warm nothing is allocated here
+    if (!slot->hasResized) {
+        ScopedTimer timer(METRIC_RESIZE);
+        Mat src = img;
+        if (format == FRAME_I420) src = img.rowRange(0, img.rows * 2 / 3);    // luma plane, no copy
+        else if (format == FRAME_YUYV) cvtColor(img, src, COLOR_YUV2GRAY_YUY2);
+        resize(src, slot->res_img, cv::Size(), scale, scale);
+        slot->hasResized = true;
+    }
+    return slot->res_img;
+}
+
+const Mat &FramePacket::grey() const {
+    if (!slot->hasGrey) {
+        const Mat &res = resized();
+        ScopedTimer timer(METRIC_RESIZE);
+        if (res.channels() == 1) slot->grey = slot->res_img;     // luma was decoded directly
+        else cvtColor(res, slot->grey, COLOR_BGR2GRAY);
+        slot->hasGrey = true;
+    }
+    return slot->grey;
+}
+
+const Mat &FramePacket::bgr() const {
+    if (!slot->hasBgr) {
+        switch (format) {
+            case FRAME_BGR:  slot->bgr = img; break;
+            case FRAME_I420: cvtColor(img, slot->bgr, COLOR_YUV2BGR_I420); break;
+            case FRAME_YUYV: cvtColor(img, slot->bgr, COLOR_YUV2BGR_YUY2); break;
+            default:         slot->bgr.release();
+        }
+        slot->hasBgr = true;
+    }
+    return slot->bgr;
+}
+
+const vector<Mat> &FramePacket::pyramid(Size winSize, int maxLevel) const {
+    if (slot->pyramidLevels != maxLevel) {
+        buildOpticalFlowPyramid(grey(), slot->pyramid, winSize, maxLevel);
+        slot->pyramidLevels = maxLevel;
+    }
+    return slot->pyramid;
+}
+
+FramePacket makePacket(const Mat &frame, int index, float scale) {
+    FramePacket packet;
+    packet.index = index;
+    packet.slot = std::make_shared<FrameSlot>();
+    packet.slot->img = frame;
+    packet.img = frame;
+    packet.format = (frame.channels() == 1) ? FRAME_LUMA : FRAME_BGR;
+    packet.scale = scale;
+    packet.blur = 0;
+    return packet;
+}
+
+ColourRecovery::ColourRecovery(const string &input, const FrameIndex *index) :
+    input(input),
+    index(index),
+    nextIndex(0),
+    nDecoded(0) {
+}
+
+Mat ColourRecovery::recover(const FramePacket &packet) {
+    if (!packet.bgr().empty()) return packet.bgr();
+
+    // only the luma plane was decoded: read the frame again, in colour
+    if (!capture.isOpened() && !capture.open(input)) return packet.img;
+    if (packet.index < nextIndex || packet.index - nextIndex > RECOVERY_MAX_GRAB) {
+        if (!index || !index->seek(capture, packet.index)) capture.set(CAP_PROP_POS_FRAMES, packet.index);
+        nextIndex = packet.index;
+    }
+    while (nextIndex < packet.index && capture.grab()) nextIndex++;
+
+    Mat frame;      // new buffer for every frame, as the exporter keeps it until written
+    if (nextIndex != packet.index || !capture.read(frame)) return packet.img;
+    nextIndex++;
+    nDecoded++;
+    return frame;
+}
+
+void analyseFrame(FramePacket &packet, FeatureBackend *features) {
+    packet.keypoints.clear();
+    packet.descriptors.release();
+    if (features) features->detectAndCompute(packet.grey(), packet.keypoints, packet.descriptors);
+    packet.blur = calcBlur(packet.grey());
+}
+
+void setKeyframe(keyframe *kframe, const FramePacket &packet) {
+    kframe->img = packet.img;
+    kframe->res_img = packet.resized();
+    kframe->grey = packet.grey();
+    kframe->keypoints = packet.keypoints;
+    kframe->descriptors = packet.descriptors;
+    kframe->slot = packet.slot;     // the keyframe takes over the slot, the previous one is released
+    // features were already computed by the analysis stage, unless it only prepared the frame for tracking
+    kframe->new_img = packet.keypoints.empty() && packet.descriptors.empty();
+}
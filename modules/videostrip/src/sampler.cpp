@@ -0,0 +1,73 @@
+/********************************************************************/
+/* Project: uwimageproc							*/
+/* Module: 	Videostrip						*/
+/* File: 	sampler.cpp                                             */
+/* Created:		17/10/2026                                          */
+/* Description
+	Adaptive frame sampler. Models the overlap decay with the keyframe from the recent measurements,
+	and predicts how many frames can be skipped (grabbed without decoding) before a new keyframe.
+*/
+/********************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include "../include/sampler.h"
+
+AdaptiveSampler::AdaptiveSampler(float minOverlap, int maxSkip) :
+    minOverlap(minOverlap),
+    maxSkip(std::max(0, maxSkip)),
+    keyIndex(0),
+    lastSkip(0) {
+}
+
+void AdaptiveSampler::reset(int keyIndex) {
+    this->keyIndex = keyIndex;
+    lastSkip = 0;
+    frames.clear();
+    overlaps.clear();
+}
+
+int AdaptiveSampler::update(int index, float overlap) {
+    // a failed estimation gives no information about the decay: restart the model and analyse densely
+    if (overlap < 0) {
+        frames.clear();
+        overlaps.clear();
+        lastSkip = 0;
+        return 0;
+    }
+    frames.push_back(index - keyIndex);
+    overlaps.push_back(overlap);
+    if (frames.size() > SKIP_HISTORY) {
+        frames.erase(frames.begin());
+        overlaps.erase(overlaps.begin());
+    }
+    if (frames.size() < SKIP_MIN_SAMPLES) return 0;
+
+    float target = minOverlap + SKIP_MARGIN;
+    if (overlap <= target) return 0;
+
+    // least squares slope of overlap vs frame distance
+    int n = (int) frames.size();
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (int i = 0; i < n; i++) {
+        sx += frames[i];
+        sy += overlaps[i];
+        sxx += (double) frames[i] * frames[i];
+        sxy += frames[i] * overlaps[i];
+    }
+    double den = n * sxx - sx * sx;
+    double rate = (den > 0) ? -(n * sxy - sx * sy) / den : 0;   // overlap lost per frame
+
+    int skip;
+    if (rate > 1e-6) {
+        // frames until the predicted overlap reaches the target, minus the one we would analyse anyway
+        double remaining = (overlap - target) / rate;
+        skip = (int) std::floor(SKIP_SAFETY * remaining) - 1;
+    }
+    else {
+        // (almost) static camera: no rate to extrapolate, probe with growing steps
+        skip = 2 * lastSkip + 1;
+    }
+    lastSkip = std::min(std::max(skip, 0), maxSkip);
+    return lastSkip;
+}
@@ -0,0 +1,191 @@
+/********************************************************************/
+/* Project: uwimageproc							*/
+/* Module: 	Videostrip						*/
+/* File: 	segments.cpp                                            */
+/* Created:		17/10/2026                                          */
+/* Description
+	Time-segmented processing of a single video. Each segment runs the keyframe selection on its own
+	thread and VideoCapture, and the keyframe chains are reconciled at the segment seams.
+*/
+/********************************************************************/
+
+#include <climits>
+#include <cstdio>
+#include <thread>
+#include <mutex>
+
+#include "../include/segments.h"
+
+static std::mutex coutMutex;    // segments report their progress from different threads
+
+// Keeps the grayscale frame of the keyframes needed to reconcile the seams: the first SEAM_HEAD, and the last one
+static void addKeyframe(Segment &segment, const SelectedKeyframe &selected, const string &filename) {
+    vector<SegmentKeyframe> &keyframes = segment.keyframes;
+    if (keyframes.size() > SEAM_HEAD) keyframes.back().grey.release();
+
+    SegmentKeyframe k;
+    k.index = selected.packet.index;
+    k.overlap = selected.overlap;
+    k.blur = selected.blur;
+    k.filename = filename;
+    selected.packet.grey().copyTo(k.grey);     // the ring slot is recycled, so we keep our own copy
+    k.dropped = false;
+    keyframes.push_back(k);
+}
+
+void processSegment(Segment &segment, const SegmentSettings &settings, KeyframeExporter &exporter, StatusFile &status) {
+    segment.ok = false;
+    VideoCapture capture(settings.input);
+    if (!capture.isOpened()) return;
+    // the index lands exactly on the first frame, the timestamp seek may land a few frames away from it
+    int first = -1;
+    if (segment.first > 0) {
+        if (settings.index && settings.index->seek(capture, segment.first)) first = segment.first;
+        else capture.set(CAP_PROP_POS_MSEC, 1000.0 * segment.first / settings.fps);
+    }
+
+    const SelectorSettings &selection = settings.selection;
+    PipelineOptions options;
+    options.nWorkers = settings.nWorkers;
+    options.queueSize = DEFAULT_QUEUE_SIZE;
+    options.resizeFactor = selection.resizeFactor;
+    options.featureType = selection.featureType;
+    options.detectFeatures = !selection.useFlow;
+    options.lumaOnly = settings.lumaOnly;
+
+    // same ring sizing as the single segment mode. Keyframes waiting in the exporter also hold their slots
+    FrameRing ring(selection.kWindow + settings.nWorkers + settings.exportWorkers + 4, settings.frameSize,
+                   settings.lumaOnly ? CV_8UC1 : CV_8UC3);
+    FramePipeline pipeline(capture, ring, options);
+    ColourRecovery recovery(settings.input, settings.index);
+    // every segment starts its own chain on its first frame. Redundant keyframes are removed later, at the seams
+    KeyframeSelector selector(selection);
+    FramePacket packet;
+    SelectedKeyframe selected;
+    ostringstream name;
+
+    ostringstream statusKey;
+    statusKey << "segment" << segment.id;
+    pipeline.start(first);
+    while (pipeline.next(packet) && !stopRequested()) {
+        // a refinement window started before the seam is completed, even if it crosses it
+        if (packet.index > segment.last && !selector.refining() && segment.ok) break;
+        segment.ok = true;
+
+        selector.push(packet);
+        // never skip past the seam, the next segment relies on this one reaching its first frame
+        if (selector.skip() > 0) pipeline.skipTo(std::min(packet.index + selector.skip() + 1, segment.last));
+
+        while (selector.pull(selected)) {
+            name.str("");
+            name << settings.prefix << "seg" << setfill('0') << setw(2) << segment.id << "_" << setw(4) << segment.keyframes.size();
+            addKeyframe(segment, selected, exporter.write(name.str(), recovery.recover(selected.packet), selected.packet.slot));
+        }
+        selected = SelectedKeyframe();
+        // current frame of every segment, for external monitors
+        if (status.enabled()) {
+            status.set(statusKey.str(), packet.index);
+            status.update("running");
+        }
+    }
+    pipeline.stop();
+    if (!segment.ok) return;
+
+    std::lock_guard<std::mutex> lock(coutMutex);
+    cout << "Segment " << segment.id << " [" << segment.keyframes.front().index << " - ";
+    if (segment.last == INT_MAX) cout << "end"; else cout << segment.last;
+    cout << "]: " << segment.keyframes.size() << " keyframes" << endl;
+}
+
+int reconcileSegments(vector<Segment> &segments, const SegmentSettings &settings) {
+    Ptr<FeatureBackend> features = FeatureBackend::create(settings.selection.featureType);
+    int nDropped = 0;
+
+    for (size_t s = 1; s < segments.size(); s++) {
+        Segment &prev = segments[s - 1];
+        Segment &curr = segments[s];
+        if (prev.keyframes.empty() || curr.keyframes.empty()) continue;
+
+        // the last keyframe of the previous segment, against which the head of this segment is checked
+        const SegmentKeyframe &last = prev.keyframes.back();
+        keyframe kframe;
+        kframe.res_img = kframe.grey = last.grey;
+        kframe.new_img = true;
+
+        size_t nHead = std::min(curr.keyframes.size(), (size_t) SEAM_HEAD);
+        for (size_t j = 0; j < nHead; j++) {
+            SegmentKeyframe &k = curr.keyframes[j];
+            bool redundant = (k.index <= last.index);
+            if (redundant) {
+                k.dropped = true;
+                nDropped++;
+                continue;
+            }
+            // overlap of the next keyframe with the previous segment, when its frame is still kept (-1 otherwise)
+            bool hasNext = (j + 1 < curr.keyframes.size());
+            float nextOverlap = -1;
+            if (hasNext && !curr.keyframes[j + 1].grey.empty())
+                nextOverlap = calcOverlap(&kframe, curr.keyframes[j + 1].grey, *features);
+            // the next keyframe still overlaps the previous segment, so the chain does not need this one
+            redundant = (nextOverlap > settings.selection.minOverlap);
+            // this keyframe repeats the last one of the previous segment (e.g. the frame shared at the seam), and
+            // the chain stays connected without it
+            if (!redundant && calcOverlap(&kframe, k.grey, *features) > settings.selection.minOverlap)
+                redundant = !hasNext || nextOverlap > 0;
+            if (!redundant) break;
+            k.dropped = true;
+            nDropped++;
+        }
+    }
+    return nDropped;
+}
+
+int processSegmented(const SegmentSettings &settings, int nSegments, int firstFrame, int nFrames,
+                     KeyframeExporter &exporter, std::ostream &reportFile, StatusFile &status) {
+    // nominal boundaries. Each segment processes up to the first frame of the next one, to share a frame at every seam
+    vector<Segment> segments(nSegments);
+    int length = std::max(1, (nFrames - firstFrame) / nSegments);
+    for (int s = 0; s < nSegments; s++) {
+        segments[s].id = s;
+        segments[s].first = firstFrame + s * length;
+        segments[s].last = (s == nSegments - 1) ? INT_MAX : firstFrame + (s + 1) * length;
+    }
+
+    vector<std::thread> threads;
+    for (int s = 0; s < nSegments; s++)
+        threads.push_back(std::thread(processSegment, std::ref(segments[s]), std::cref(settings), std::ref(exporter),
+                                      std::ref(status)));
+    for (int s = 0; s < nSegments; s++)
+        threads[s].join();
+
+    // when stopped by a signal, segments that did not get to start are just left empty
+    for (int s = 0; s < nSegments; s++)
+        if (!segments[s].ok && !stopRequested()) {
+            cerr << "Unable to process segment " << s << " from: " << settings.input << endl;
+            return -1;
+        }
+
+    int nDropped = reconcileSegments(segments, settings);
+    cout << "Keyframes discarded at the seams: " << nDropped << endl;
+
+    // files must be on disk before renaming them to the final sequence
+    exporter.flush();
+    int out_frame = 0;
+    ostringstream name;
+    for (int s = 0; s < nSegments; s++) {
+        for (size_t j = 0; j < segments[s].keyframes.size(); j++) {
+            const SegmentKeyframe &k = segments[s].keyframes[j];
+            if (k.dropped) {
+                std::remove(k.filename.c_str());
+                continue;
+            }
+            name.str("");
+            name << settings.prefix << setfill('0') << setw(4) << out_frame << exporter.extension();
+            if (std::rename(k.filename.c_str(), name.str().c_str()) != 0)
+                cerr << "Unable to rename " << k.filename << " to " << name.str() << endl;
+            reportFile << out_frame << "\t" << k.index << "\t" << name.str() << "\t" << k.overlap << "\t" << k.blur << endl;
+            out_frame++;
+        }
+    }
+    return out_frame;
+}
@@ -0,0 +1,138 @@
+/********************************************************************/
+/* Project: uwimageproc							*/
+/* Module: 	Videostrip						*/
+/* File: 	selector.cpp                                            */
+/* Created:		17/10/2026                                          */
+/* Description
+	Keyframe selection engine. Implements the overlap / best blur search of videostrip as a state
+	machine fed frame by frame, so it can be driven by the CLI, by the segmented mode or embedded.
+*/
+/********************************************************************/
+
+#include "../include/selector.h"
+
+KeyframeSelector::KeyframeSelector(const SelectorSettings &settings) :
+    settings(settings),
+    features(FeatureBackend::create(settings.featureType)),
+    sampler(settings.minOverlap) {
+    reset();
+}
+
+void KeyframeSelector::reset() {
+    kframe = keyframe();
+    kframe.new_img = true;
+    hasKeyframe = false;
+    best = FramePacket();
+    best.blur = 0;
+    triggerOverlap = 0;
+    windowLeft = 0;
+    windowPos = 0;
+    windowBest = 0;
+    lastOverlap = 0;
+    lastMeasured = false;
+    skipHint = 0;
+    selected.clear();
+}
+
+void KeyframeSelector::push(const Mat &frame, int index) {
+    FramePacket packet = makePacket(frame, index, settings.resizeFactor);
+    analyseFrame(packet, settings.useFlow ? NULL : features.get());
+    push(packet);
+}
+
+void KeyframeSelector::push(const FramePacket &packet) {
+    lastMeasured = false;
+    skipHint = 0;
+
+    // we use the first frame as keyframe
+    if (!hasKeyframe) {
+        commit(packet, 0.0, 0.0);
+        return;
+    }
+
+    // inside the refinement window: keep the sharpest frame, according to the Laplacian variance
+    if (windowLeft > 0) {
+        float blur = packet.blur;
+    #if USE_GPU
+        if (settings.useGPU) blur = calcBlurGPU(packet.grey());
+    #endif
+        windowPos++;
+        if (blur > best.blur) {
+            best = packet;      // previous candidate releases its slot
+            best.blur = blur;
+        }
+        windowBest = best.blur;
+        if (--windowLeft == 0) commit(best, triggerOverlap, best.blur);
+        return;
+    }
+
+    lastOverlap = estimateOverlap(packet);
+    lastMeasured = true;
+
+    //special case: overlap cannot be computed, we force it with a value that may trigger a new keyframe
+    float currOverlap = (lastOverlap == -2.0) ? OVERLAP_MIN + 0.01 : lastOverlap;
+
+    // far from minOverlap, the caller can skip the frames predicted to keep a larger overlap. The sampler gets the
+    // measured value: the forced one is not a measurement, and a failure must restart its model instead
+    if (settings.adaptive && (lastOverlap < 0 || currOverlap > settings.minOverlap))
+        skipHint = sampler.update(packet.index, lastOverlap);
+
+    if (currOverlap > settings.minOverlap) return;
+
+    // start the search of the best frame, beginning with the current one
+    best = packet;
+#if USE_GPU
+    if (settings.useGPU) best.blur = calcBlurGPU(packet.grey());
+#endif
+    triggerOverlap = currOverlap;
+    windowLeft = settings.kWindow;
+    windowPos = 0;
+    windowBest = best.blur;
+    if (windowLeft <= 0) commit(best, triggerOverlap, best.blur);
+}
+
+bool KeyframeSelector::pull(SelectedKeyframe &keyframe) {
+    if (selected.empty()) return false;
+    keyframe = selected.front();
+    selected.pop_front();
+    return true;
+}
+
+float KeyframeSelector::estimateOverlap(const FramePacket &packet) {
+#if USE_GPU
+    if (settings.useGPU) return calcOverlapGPU(&kframe, packet.grey());
+#endif
+    if (settings.useFlow) return trackOverlap(&kframe, packet, tracker, *features);
+    // packets analysed without features (e.g. by a pipeline prepared for tracking) are detected here
+    if (packet.descriptors.empty()) return calcOverlap(&kframe, packet.grey(), *features);
+    return calcOverlap(&kframe, packet.keypoints, packet.descriptors, *features);
+}
+
+void KeyframeSelector::resume(const FramePacket &packet) {
+    reset();
+    adopt(packet);
+}
+
+void KeyframeSelector::adopt(const FramePacket &packet) {
+    // the new keyframe takes over the slot of the packet, and reuses its features
+    setKeyframe(&kframe, packet);
+#if USE_GPU
+    if (settings.useGPU) kframe.new_img = true;    // GPU path computes its own keyframe descriptors
+#endif
+    hasKeyframe = true;
+    if (settings.useFlow) tracker.reset(packet);
+    sampler.reset(packet.index);
+}
+
+void KeyframeSelector::commit(const FramePacket &packet, float overlap, float blur) {
+    adopt(packet);
+
+    SelectedKeyframe k;
+    k.packet = packet;
+    k.overlap = overlap;
+    k.blur = blur;
+    selected.push_back(k);
+
+    best = FramePacket();
+    best.blur = 0;
+}
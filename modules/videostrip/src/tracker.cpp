@@ -0,0 +1,100 @@
+/********************************************************************/
+/* Project: uwimageproc							*/
+/* Module: 	Videostrip						*/
+/* File: 	tracker.cpp                                             */
+/* Created:		17/10/2026                                          */
+/* Description
+	Sparse optical flow overlap estimator. Corners of the keyframe are tracked with pyramidal
+	Lucas-Kanade, and descriptor matching is only used when the tracks are lost.
+*/
+/********************************************************************/
+
+#include "../include/tracker.h"
+
+OverlapTracker::OverlapTracker(int maxCorners, int minTracks) :
+    maxCorners(maxCorners),
+    minTracks(minTracks) {
+}
+
+void OverlapTracker::reset(const FramePacket &key) {
+    prev = key;
+    frameSize = key.grey().size();
+    goodFeaturesToTrack(key.grey(), keyPts, maxCorners, FLOW_CORNER_QUALITY, FLOW_MIN_DISTANCE);
+    currPts = keyPts;
+}
+
+void OverlapTracker::reseed(const FramePacket &packet, const Mat &H) {
+    prev = packet;
+    goodFeaturesToTrack(packet.grey(), currPts, maxCorners, FLOW_CORNER_QUALITY, FLOW_MIN_DISTANCE);
+    // the new corners are projected into the keyframe, so overlap keeps being measured against it
+    keyPts.clear();
+    if (!currPts.empty()) perspectiveTransform(currPts, keyPts, H);
+}
+
+float OverlapTracker::update(const FramePacket &packet, Mat &H) {
+    if ((int) currPts.size() < minTracks || !prev.slot) return TRACK_LOST;
+
+    // both pyramids come from the frame caches: each frame builds its pyramid once, when it is first tracked
+    Size winSize(FLOW_WINDOW_SIZE, FLOW_WINDOW_SIZE);
+    ScopedTimer flowTimer(METRIC_FLOW);
+    calcOpticalFlowPyrLK(prev.pyramid(winSize, FLOW_MAX_LEVEL), packet.pyramid(winSize, FLOW_MAX_LEVEL),
+                         currPts, nextPts, status, err, winSize, FLOW_MAX_LEVEL);
+    flowTimer.stop();
+    prev = packet;      // releases the slot of the previous frame
+
+    // keep only the corners that were found again, and are still inside the frame
+    size_t n = 0;
+    for (size_t i = 0; i < nextPts.size(); i++) {
+        const Point2f &p = nextPts[i];
+        if (!status[i] || p.x < 0 || p.y < 0 || p.x >= frameSize.width || p.y >= frameSize.height) continue;
+        keyPts[n] = keyPts[i];
+        currPts[n] = p;
+        n++;
+    }
+    keyPts.resize(n);
+    currPts.resize(n);
+    recordValue(METRIC_TRACKS, n);
+    if ((int) n < minTracks) return TRACK_LOST;
+
+    ScopedTimer homographyTimer(METRIC_HOMOGRAPHY);
+    H = findHomography(currPts, keyPts, RANSAC, 3, inliers);
+    homographyTimer.stop();
+    if (H.empty()) {
+        currPts.clear();
+        keyPts.clear();
+        return TRACK_LOST;
+    }
+
+    // outliers are dropped, so they do not drift along the following frames
+    n = 0;
+    for (size_t i = 0; i < inliers.size(); i++) {
+        if (!inliers[i]) continue;
+        keyPts[n] = keyPts[i];
+        currPts[n] = currPts[i];
+        n++;
+    }
+    keyPts.resize(n);
+    currPts.resize(n);
+
+    return overlapArea(H, frameSize);
+}
+
+float trackOverlap(keyframe *kframe, const FramePacket &packet, OverlapTracker &tracker, FeatureBackend &features) {
+    Mat H;
+    float overlap = tracker.update(packet, H);
+    if (overlap >= 0) return overlap;
+
+    // not enough tracks left: match descriptors against the keyframe. Keyframe descriptors are extracted only once
+    if (kframe->new_img) {
+        features.detectAndCompute(kframe->grey, kframe->keypoints, kframe->descriptors);
+        kframe->new_img = false;
+    }
+    vector<KeyPoint> keypoints;
+    Mat descriptors;
+    features.detectAndCompute(packet.grey(), keypoints, descriptors);
+
+    overlap = calcOverlap(kframe, keypoints, descriptors, features, &H);
+    // with a valid homography we can start tracking again from this frame
+    if (overlap >= 0) tracker.reseed(packet, H);
+    return overlap;
+}
@@ -16,30 +16,22 @@
 /* Victor Garcia - victorygarciac@gmail.com                         */
 /********************************************************************/
 
+#include <cfloat>
+#include <cmath>
+
 #include "../include/videostrip.hpp"
 
 // #cmakedefine USE_GPU
 
-#if USE_GPU
-    extern GpuMat auxD;    // Auxilary GpuMat to keep track of descriptors
-#endif
-
-
-// Video width and height
-extern int videoWidth, videoHeight;
-// Resize factor from original video frame size to desired TARGET_WIDTH or TARGET_HEIGHT
-// This is for fast motion estimation through homography. Perhaps some optical-flow approach could work faster
-// Image tiling may improve homography quality by forcing well-spread control points along the image (See CIRS paper)
-extern float hResizeFactor;
-
 
 //TODO: improve names and description of local variables for several specific local-scope use
 
 #if USE_GPU
 float calcBlurGPU(Mat frame) {
     // Avg time: 0.7 ms GPU/ 23ms CPU
-    Mat grey, laplacian;
-    cvtColor(frame, grey, COLOR_BGR2GRAY);
+    ScopedTimer timer(METRIC_BLUR);
+    Mat grey = frame, laplacian;
+    if (frame.channels() == 3) cvtColor(frame, grey, COLOR_BGR2GRAY);
 
     cuda::GpuMat gpuFrame, gpuLaplacian;
     //upload into GPU memory
@@ -68,46 +60,45 @@ float calcOverlapGPU(keyframe* kframe, Mat img_object) {
     }
     //-- Step 1: Detect the keypoints using SURF Detector
     // Convert to grayscale
-    cvtColor(img_object, img_object, COLOR_BGR2GRAY);
+    Mat grey_object = img_object;
+    if (img_object.channels() == 3) cvtColor(img_object, grey_object, COLOR_BGR2GRAY);
 
     vector<KeyPoint> keypoints_object, keypoints_scene;
     cuda::GpuMat gpu_img_objectGPU, gpu_img_sceneGPU;
     cuda::GpuMat keypoints_objectGPU, keypoints_sceneGPU;
     cuda::GpuMat descriptors_objectGPU, descriptors_sceneGPU;
     
+    ScopedTimer detectTimer(METRIC_DETECT);
     // Upload to GPU
-    gpu_img_objectGPU.upload(img_object);
+    gpu_img_objectGPU.upload(grey_object);
     // Detect keypoints
     cuda::SURF_CUDA surf;
     surf(gpu_img_objectGPU, cuda::GpuMat(), keypoints_objectGPU, descriptors_objectGPU);
     surf.downloadKeypoints(keypoints_objectGPU, keypoints_object);
     if(kframe->new_img){
-        cvtColor(kframe->res_img, kframe->res_img, COLOR_BGR2GRAY);
-        gpu_img_sceneGPU.upload(kframe->res_img);
+        if (kframe->grey.empty()) cvtColor(kframe->res_img, kframe->grey, COLOR_BGR2GRAY);
+        gpu_img_sceneGPU.upload(kframe->grey);
         surf(gpu_img_sceneGPU, cuda::GpuMat(), keypoints_sceneGPU, descriptors_sceneGPU);
-        auxD = descriptors_sceneGPU;
+        kframe->descriptorsGPU = descriptors_sceneGPU;
         surf.downloadKeypoints(keypoints_sceneGPU, kframe->keypoints);
         kframe->new_img = false;
     }
+    detectTimer.stop();
+    recordValue(METRIC_KEYPOINTS, keypoints_object.size());
 
     keypoints_scene = kframe->keypoints;
-    descriptors_sceneGPU = auxD;
- 
-
-#ifdef _VERBOSE_ON_
-    t = 1000 * ((double) getTickCount() - t) / getTickFrequency();
-    cout << endl << "SURF@GPU: " << t << " ms ";
-    t = (double) getTickCount();
-#endif
+    descriptors_sceneGPU = kframe->descriptorsGPU;
 
     //***************************************************************//
     //-- Step 3: Matching descriptor vectors using GPU BruteForce matcher (instead CPU FLANN)
     // Avg time: 2.5 ms GPU / 21 ms CPU
     double min_dist = 100;
 
+    ScopedTimer matchTimer(METRIC_MATCH);
     Ptr<cuda::DescriptorMatcher> matcher_gpu = cuda::DescriptorMatcher::createBFMatcher();
     vector< vector< DMatch> > matches;
     matcher_gpu->knnMatch(descriptors_objectGPU, descriptors_sceneGPU, matches, 2);
+    matchTimer.stop();
 
     //-- Step 4: Select only good matches
     vector<DMatch> good_matches;
@@ -119,12 +110,7 @@ float calcOverlapGPU(keyframe* kframe, Mat img_object) {
             good_matches.push_back(matches[k][0]);  //push into the good_matches list
         }
     }
- 
-#ifdef _VERBOSE_ON_
-    t = 1000 * ((double) getTickCount() - t) / getTickFrequency();
-    cout << "\t | BFMatcher GPU: " << t << " ms ";
-    t = (double) getTickCount();
-#endif
+    recordValue(METRIC_GOOD_MATCHES, good_matches.size());
 
     //***************************************************************//
     //we must check if found H matrix is good enough. It requires at least 4 points
@@ -146,7 +132,9 @@ float calcOverlapGPU(keyframe* kframe, Mat img_object) {
         // TODO: As OpenCV 3.2, there is no GPU based implementation for findHomography.
         // Check http://nghiaho.com/?page_id=611 for an external solution
         // Avg time: 0.7 ms CPU
+        ScopedTimer homographyTimer(METRIC_HOMOGRAPHY);
         Mat H = findHomography(obj, scene, RANSAC);
+        homographyTimer.stop();
 		
 		if (H.empty())	return -2.0;
 
@@ -155,32 +143,158 @@ float calcOverlapGPU(keyframe* kframe, Mat img_object) {
         // float dy = fabs(H.at<double>(1, 2));
         // float overlap = (videoWidth - dx) * (videoHeight - dy) / (videoWidth * videoHeight);
         
-        float overlap = overlapArea(H)/ (videoWidth * videoHeight);
-
-#ifdef _VERBOSE_ON_
-        t = 1000 * ((double) getTickCount() - t) / getTickFrequency();
-        cout << "\t | Homography: " << t << " ms" << endl;
-        t = (double) getTickCount();
-#endif
+        float overlap = overlapArea(H, kframe->res_img.size());
         return overlap;
     }
 }
 #endif //endif GPU
 
-float calcBlur(Mat frame) {
-    // Avg time: 0.7 ms GPU/ 23ms CPU
-    Mat grey, laplacian;
-    cvtColor(frame, grey, COLOR_BGR2GRAY);
-    //perform Laplacian filter
-    Laplacian(grey, laplacian, grey.type(), CV_16S);
-    //we compute the laplacian of the current frame
-    Scalar mean, stdev;
-    // the we compute the mean and stdev of that frame
-    meanStdDev(laplacian, mean, stdev);
-    // double m = mean.val[0];
-    // double s = stdev.val[0];
-    // we return the standard deviation (stdev)
-    return stdev.val[0];
+// Fixed point BGR to luma conversion, same coefficients and rounding as cvtColor(COLOR_BGR2GRAY) for 8-bit images
+#define LUMA_SHIFT  14
+#define LUMA_B      1868
+#define LUMA_G      9617
+#define LUMA_R      4899
+
+// index of a row/column outside the image, mirrored as BORDER_REFLECT_101 (default border of Laplacian)
+static inline int reflect101(int i, int n) {
+    if (n == 1) return 0;
+    if (i < 0) return -i;
+    if (i >= n) return 2 * n - 2 - i;
+    return i;
+}
+
+#if CV_SSE2
+// luma of 8 pixels, given as 16-bit B, G and R
+static inline __m128i lumaSSE2(__m128i b, __m128i g, __m128i r) {
+    const __m128i kBG = _mm_set_epi16(LUMA_G, LUMA_B, LUMA_G, LUMA_B, LUMA_G, LUMA_B, LUMA_G, LUMA_B);
+    const __m128i kR = _mm_set_epi16(1 << (LUMA_SHIFT - 1), LUMA_R, 1 << (LUMA_SHIFT - 1), LUMA_R,
+                                     1 << (LUMA_SHIFT - 1), LUMA_R, 1 << (LUMA_SHIFT - 1), LUMA_R);
+    const __m128i one = _mm_set1_epi16(1);
+    // pairs (b, g) and (r, 1) are multiplied and added in 32 bits: b*B + g*G and r*R + rounding
+    __m128i lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(b, g), kBG), _mm_madd_epi16(_mm_unpacklo_epi16(r, one), kR));
+    __m128i hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(b, g), kBG), _mm_madd_epi16(_mm_unpackhi_epi16(r, one), kR));
+    return _mm_packs_epi32(_mm_srli_epi32(lo, LUMA_SHIFT), _mm_srli_epi32(hi, LUMA_SHIFT));
+}
+#endif
+
+// luma of a single BGR or BGRA row
+static void lumaRow(const uchar *src, uchar *dst, int cols, int channels) {
+    int x = 0;
+#if CV_SSE2
+    if (channels == 3) {
+        const __m128i zero = _mm_setzero_si128();
+        for (; x + 32 <= cols; x += 32, src += 96) {
+            __m128i v[6], o[6];
+            for (int i = 0; i < 6; i++) v[i] = _mm_loadu_si128((const __m128i*) (src + 16 * i));
+            // five rounds of byte interleaving split 32 BGR pixels into B (v0, v1), G (v2, v3) and R (v4, v5)
+            for (int round = 0; round < 5; round++) {
+                for (int i = 0; i < 3; i++) {
+                    o[2 * i] = _mm_unpacklo_epi8(v[i], v[i + 3]);
+                    o[2 * i + 1] = _mm_unpackhi_epi8(v[i], v[i + 3]);
+                }
+                for (int i = 0; i < 6; i++) v[i] = o[i];
+            }
+            for (int i = 0; i < 2; i++) {
+                __m128i y0 = lumaSSE2(_mm_unpacklo_epi8(v[i], zero), _mm_unpacklo_epi8(v[2 + i], zero), _mm_unpacklo_epi8(v[4 + i], zero));
+                __m128i y1 = lumaSSE2(_mm_unpackhi_epi8(v[i], zero), _mm_unpackhi_epi8(v[2 + i], zero), _mm_unpackhi_epi8(v[4 + i], zero));
+                _mm_storeu_si128((__m128i*) (dst + x + 16 * i), _mm_packus_epi16(y0, y1));
+            }
+        }
+    }
+#endif
+    for (; x < cols; x++, src += channels)
+        dst[x] = (uchar) ((src[0] * LUMA_B + src[1] * LUMA_G + src[2] * LUMA_R + (1 << (LUMA_SHIFT - 1))) >> LUMA_SHIFT);
+}
+
+float calcBlur(const Mat &frame) {
+    ScopedTimer timer(METRIC_BLUR);
+    CV_Assert(frame.depth() == CV_8U && (frame.channels() == 1 || frame.channels() == 3 || frame.channels() == 4));
+    const int rows = frame.rows, cols = frame.cols, channels = frame.channels();
+    if (rows == 0 || cols == 0) return 0;
+
+    // Single streaming pass: each row is converted to luma once, into a rolling buffer of 3 rows that stays in cache,
+    // and the 4-neighbour Laplacian (same as Laplacian(grey, dst, CV_16S), ksize 1) is accumulated on the fly into sum
+    // and sum of squares. No intermediate image is allocated, and the buffer is reused by the following calls.
+    // Grayscale frames (e.g. the cached grey image of a FramePacket) are read in place
+    const bool isGrey = (channels == 1);
+    static thread_local vector<uchar> buffer;
+    uchar *ring[3] = { NULL, NULL, NULL };
+    if (!isGrey) {
+        buffer.resize(3 * (size_t) cols);
+        ring[0] = &buffer[0];
+        ring[1] = &buffer[cols];
+        ring[2] = &buffer[2 * cols];
+        lumaRow(frame.ptr<uchar>(0), ring[0], cols, channels);
+        if (rows > 1) lumaRow(frame.ptr<uchar>(1), ring[1], cols, channels);
+    }
+
+    int64 sum = 0, sqsum = 0;
+    for (int y = 0; y < rows; y++) {
+        const uchar *up, *mid, *down;
+        if (isGrey) {
+            up = frame.ptr<uchar>(reflect101(y - 1, rows));
+            mid = frame.ptr<uchar>(y);
+            down = frame.ptr<uchar>(reflect101(y + 1, rows));
+        } else {
+            if (y + 1 < rows && y > 0) lumaRow(frame.ptr<uchar>(y + 1), ring[(y + 1) % 3], cols, channels);
+            up = ring[reflect101(y - 1, rows) % 3];
+            mid = ring[y % 3];
+            down = ring[reflect101(y + 1, rows) % 3];
+        }
+
+        // image borders (first and last column), mirrored
+        int xs[2] = { 0, cols - 1 };
+        for (int k = 0; k < (cols > 1 ? 2 : 1); k++) {
+            int x = xs[k];
+            int lap = up[x] + down[x] + mid[reflect101(x - 1, cols)] + mid[reflect101(x + 1, cols)] - 4 * mid[x];
+            sum += lap;
+            sqsum += lap * lap;
+        }
+
+        int x = 1;
+#if CV_SSE2
+        // 16 pixels per iteration. Each int32 lane accumulates at most 4 * 1020^2 per iteration: flushed every
+        // 512 iterations, so it never overflows
+        const __m128i zero = _mm_setzero_si128(), ones = _mm_set1_epi16(1);
+        while (x + 16 <= cols - 1) {
+            __m128i vsum = _mm_setzero_si128(), vsqsum = _mm_setzero_si128();
+            for (int n = 0; n < 512 && x + 16 <= cols - 1; n++, x += 16) {
+                __m128i u = _mm_loadu_si128((const __m128i*) (up + x));
+                __m128i d = _mm_loadu_si128((const __m128i*) (down + x));
+                __m128i l = _mm_loadu_si128((const __m128i*) (mid + x - 1));
+                __m128i r = _mm_loadu_si128((const __m128i*) (mid + x + 1));
+                __m128i c = _mm_loadu_si128((const __m128i*) (mid + x));
+
+                __m128i lo = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(u, zero), _mm_unpacklo_epi8(d, zero)),
+                                           _mm_add_epi16(_mm_unpacklo_epi8(l, zero), _mm_unpacklo_epi8(r, zero)));
+                __m128i hi = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(u, zero), _mm_unpackhi_epi8(d, zero)),
+                                           _mm_add_epi16(_mm_unpackhi_epi8(l, zero), _mm_unpackhi_epi8(r, zero)));
+                lo = _mm_sub_epi16(lo, _mm_slli_epi16(_mm_unpacklo_epi8(c, zero), 2));
+                hi = _mm_sub_epi16(hi, _mm_slli_epi16(_mm_unpackhi_epi8(c, zero), 2));
+
+                vsum = _mm_add_epi32(vsum, _mm_add_epi32(_mm_madd_epi16(lo, ones), _mm_madd_epi16(hi, ones)));
+                vsqsum = _mm_add_epi32(vsqsum, _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+            }
+            int CV_DECL_ALIGNED(16) s[4], q[4];
+            _mm_store_si128((__m128i*) s, vsum);
+            _mm_store_si128((__m128i*) q, vsqsum);
+            sum += (int64) s[0] + s[1] + s[2] + s[3];
+            sqsum += (int64) q[0] + q[1] + q[2] + q[3];
+        }
+#endif
+        // remaining interior pixels
+        for (; x < cols - 1; x++) {
+            int lap = up[x] + down[x] + mid[x - 1] + mid[x + 1] - 4 * mid[x];
+            sum += lap;
+            sqsum += lap * lap;
+        }
+    }
+
+    // standard deviation of the Laplacian, as meanStdDev() does
+    double n = (double) rows * cols;
+    double mean = sum / n;
+    double variance = std::max(sqsum / n - mean * mean, 0.0);
+    return (float) std::sqrt(variance);
 }
 
 /*! @fn float calcOverlap(Mat img_scene, Mat img_object)
@@ -189,131 +303,177 @@ float calcBlur(Mat frame) {
     @param img_object	Mat OpenCV matrix container of target frame
 	@brief retval		The normalized overlap among two given frame
 */
-float calcOverlap(keyframe* kframe, Mat img_object) {
+float calcOverlap(keyframe* kframe, Mat img_object, FeatureBackend &features) {
 	// if any of the input images are empty, then exits with error code
     if (! img_object.data || ! kframe->res_img.data) {
         cout << " --(!) Error reading images " << std::endl;
         return - 1;
     }
 
-    //-- Step 1: Detect the keypoints using SURF Detector
-    int minHessian = 400;
-    // Convert to grayscale
-    cvtColor(img_object, img_object, COLOR_BGR2GRAY);
+    // Convert to grayscale, unless we were already given the grayscale frame
+    Mat grey_object = img_object;
+    if (img_object.channels() == 3) cvtColor(img_object, grey_object, COLOR_BGR2GRAY);
 
-    Mat descriptors_object, descriptors_scene;
-    vector<KeyPoint> keypoints_object, keypoints_scene;
-    Ptr<SURF> detector = SURF::create(minHessian);
-    // If we have a new keyframe compute the keypoints
-    detector->detectAndCompute(img_object, Mat(), keypoints_object, descriptors_object);
+    Mat descriptors_object;
+    vector<KeyPoint> keypoints_object;
+    //-- Step 1: Detect the keypoints using the selected feature backend
+    features.detectAndCompute(grey_object, keypoints_object, descriptors_object);
+    // If we have a new keyframe compute the keypoints. Its resized frame is left untouched, it may be shared
     if(kframe->new_img){
-        cvtColor(kframe->res_img, kframe->res_img, COLOR_BGR2GRAY);
-        detector->detectAndCompute(kframe->res_img, Mat(), kframe->keypoints, kframe->descriptors);
+        if (kframe->grey.empty()) cvtColor(kframe->res_img, kframe->grey, COLOR_BGR2GRAY);
+        features.detectAndCompute(kframe->grey, kframe->keypoints, kframe->descriptors);
         kframe->new_img = false;
     }
 
-    keypoints_scene = kframe->keypoints;
-    descriptors_scene = kframe->descriptors;
- 
-#ifdef _VERBOSE_ON_
-    t = 1000 * ((double) getTickCount() - t) / getTickFrequency();
-    cout << endl << "SURF@GPU: " << t << " ms ";
-    t = (double) getTickCount();
-#endif
+    return calcOverlap(kframe, keypoints_object, descriptors_object, features);
+}
+
+float calcOverlap(keyframe* kframe, const vector<KeyPoint> &keypoints_object, const Mat &descriptors_object, FeatureBackend &features, Mat *homography) {
+    // without descriptors on both sides there is nothing to match
+    if (descriptors_object.empty() || kframe->descriptors.empty()) {
+        cout << "[WARN] Not enough good matches!" << endl;
+        return -2.0;
+    }
+
+    int nGood = 0;
+    Mat H = matchHomography(keypoints_object, descriptors_object, kframe->keypoints, kframe->descriptors, features, &nGood);
+    recordValue(METRIC_GOOD_MATCHES, nGood);
 
     //***************************************************************//
-    //-- Step 3: Matching descriptor vectors using GPU BruteForce matcher (instead CPU FLANN)
-    // Avg time: 2.5 ms GPU / 21 ms CPU
-    double min_dist = 100;
+    //we must check if found H matrix is good enough. It requires at least 4 points
+    if (nGood < 4) {
+        cout << "[WARN] Not enough good matches!" << endl;
+        //we fail to estimate new minOverlap
+        return -2.0;
+    }
+    if (H.empty())	return -2.0;
+    if (homography) *homography = H;
+
+    // Old minOverlap area calc method ----
+    // float dx = fabs(H.at<double>(0, 2));
+    // float dy = fabs(H.at<double>(1, 2));
+    // float minOverlap = (videoWidth - dx) * (videoHeight - dy) / (videoWidth * videoHeight);
+    // ---------------------------------
+
+    float minOverlap = overlapArea(H, kframe->res_img.size());
+    return minOverlap;
+}
+
+Mat matchHomography(const vector<KeyPoint> &keypoints_object, const Mat &descriptors_object,
+                    const vector<KeyPoint> &keypoints_scene, const Mat &descriptors_scene,
+                    FeatureBackend &features, int *nMatches, int *nInliers) {
+    if (nMatches) *nMatches = 0;
+    if (nInliers) *nInliers = 0;
+    if (descriptors_object.empty() || descriptors_scene.empty()) return Mat();
 
-    Ptr<BFMatcher> matcher = BFMatcher::create();
+    //***************************************************************//
+    //-- Step 3: Matching descriptor vectors using BruteForce matcher (L2 for float descriptors, Hamming for binary ones)
+    // Avg time: 2.5 ms GPU / 21 ms CPU
     vector<vector<DMatch> > matches;
-    matcher->knnMatch(descriptors_object, descriptors_scene, matches, 2);
+    features.knnMatch(descriptors_object, descriptors_scene, matches);
 
     //-- Step 4: Select only good matches
     std::vector<DMatch> good_matches;
     for (int k = 0; k < std::min(keypoints_object.size() - 1, matches.size()); k ++) {
-        if ((matches[k][0].distance < 0.8 * (matches[k][1].distance)) &&
-            ((int) matches[k].size() <= 2 && (int) matches[k].size() > 0)) {
+        // binary backends may return a single neighbour when the keyframe has very few descriptors
+        if (((int) matches[k].size() == 2) &&
+            (matches[k][0].distance < 0.8 * (matches[k][1].distance))) {
             // take the first result only if its distance is smaller than 0.6*second_best_dist
             // that means this descriptor is ignored if the second distance is bigger or of similar
             good_matches.push_back(matches[k][0]);
         }
     }
+    if (nMatches) *nMatches = (int) good_matches.size();
+    // a homography requires at least 4 points
+    if (good_matches.size() < 4) return Mat();
 
-#ifdef _VERBOSE_ON_
-    t = 1000 * ((double) getTickCount() - t) / getTickFrequency();
-    cout << "\t | BFMatcher GPU: " << t << " ms ";
-    t = (double) getTickCount();
-#endif
+    //-- Localize the object
+    vector<Point2f> obj, scene;
 
-    //***************************************************************//
-    //we must check if found H matrix is good enough. It requires at least 4 points
-    if (good_matches.size() < 4) {
-        cout << "[WARN] Not enough good matches!" << endl;
-        //we fail to estimate new minOverlap
-        return -2.0;
+    for (int i = 0; i < good_matches.size(); i ++) {
+        //-- Get the keypoints from the good matches
+        obj.push_back(keypoints_object[good_matches[i].queryIdx].pt);
+        scene.push_back(keypoints_scene[good_matches[i].trainIdx].pt);
     }
-    else {
-        //-- Localize the object
-        vector<Point2f> obj, scene;
-
-        for (int i = 0; i < good_matches.size(); i ++) {
-            //-- Get the keypoints from the good matches
-            obj.push_back(keypoints_object[good_matches[i].queryIdx].pt);
-            scene.push_back(keypoints_scene[good_matches[i].trainIdx].pt);
-        }
 
-        // TODO: As OpenCV 3.2, there is no GPU based implementation for findHomography.
-        // Check http://nghiaho.com/?page_id=611 for an external solution
-        // Avg time: 0.7 ms CPU
-        Mat H = findHomography(obj, scene, RANSAC);
-		
-		if (H.empty())	return -2.0;
+    // TODO: As OpenCV 3.2, there is no GPU based implementation for findHomography.
+    // Check http://nghiaho.com/?page_id=611 for an external solution
+    // Avg time: 0.7 ms CPU
+    ScopedTimer homographyTimer(METRIC_HOMOGRAPHY);
+    Mat inliers;
+    Mat H = findHomography(obj, scene, RANSAC, 3, inliers);
+    homographyTimer.stop();
+    if (nInliers && !H.empty()) *nInliers = countNonZero(inliers);
+    return H;
+}
 
-        // Old minOverlap area calc method ----
-        // float dx = fabs(H.at<double>(0, 2));
-        // float dy = fabs(H.at<double>(1, 2));
-        // float minOverlap = (videoWidth - dx) * (videoHeight - dy) / (videoWidth * videoHeight);
-        // ---------------------------------
-        
-        float minOverlap = overlapArea(H);
+// Sutherland-Hodgman step: clips the polygon (in, n) against the half-plane coord(axis) >= bound (or <= bound when
+// keepGreater is false), and writes the result into out. Returns the number of vertices of the clipped polygon
+static int clipPolygon(const Point2d *in, int n, Point2d *out, int axis, double bound, bool keepGreater) {
+    int m = 0;
+    for (int i = 0; i < n; i++) {
+        const Point2d &prev = in[(i + n - 1) % n];
+        const Point2d &curr = in[i];
+        double cPrev = (axis == 0) ? prev.x : prev.y;
+        double cCurr = (axis == 0) ? curr.x : curr.y;
+        bool inPrev = keepGreater ? (cPrev >= bound) : (cPrev <= bound);
+        bool inCurr = keepGreater ? (cCurr >= bound) : (cCurr <= bound);
+
+        // the edge crosses the boundary: add the intersection point
+        if (inPrev != inCurr) {
+            double t = (bound - cPrev) / (cCurr - cPrev);
+            out[m++] = Point2d(prev.x + t * (curr.x - prev.x), prev.y + t * (curr.y - prev.y));
+        }
+        if (inCurr) out[m++] = curr;
+    }
+    return m;
+}
 
-#ifdef _VERBOSE_ON_
-        t = 1000 * ((double) getTickCount() - t) / getTickFrequency();
-        cout << "\t | Homography: " << t << " ms" << endl;
-        t = (double) getTickCount();
-#endif
-        return minOverlap;
+// Shoelace formula, absolute area of the polygon (pts, n)
+static double polygonArea(const Point2d *pts, int n) {
+    double area = 0.0;
+    for (int i = 0; i < n; i++) {
+        const Point2d &p = pts[i];
+        const Point2d &q = pts[(i + 1) % n];
+        area += p.x * q.y - q.x * p.y;
     }
+    return std::fabs(area) * 0.5;
 }
-// TODO: IMPROVE OVERLAP AREA WHEN ASPECT RATIO IS NOT THE SAME
-float overlapArea(Mat H){
-    vector<Point2f> points, final_points;
-    float area_percent, area_currOverlap, area_img1, area_img2;
-    // initialize the initial points in the corners of the original image
-	points.push_back(Point2f(0,0));
-	points.push_back(Point2f(TARGET_WIDTH,0));
-	points.push_back(Point2f(TARGET_WIDTH,TARGET_HEIGHT));
-	points.push_back(Point2f(0,TARGET_HEIGHT));
-
-    // transform the original points by the given homography matrix
-	perspectiveTransform(points,final_points, H);
-
-    // Save the transformed points into an array for fillConvexPoly function
-    Point points_array[4] = {final_points[0], final_points[1], final_points[2], final_points[3]};
-
-    Mat mask(TARGET_HEIGHT, TARGET_WIDTH, CV_8UC1, Scalar(0,0,0));
-    // Fill the area inside the transformed points
-	// TODO: overlap area can be computed faster through geometrical methods using the vertex of the convex polygon
-    fillConvexPoly( mask, points_array, 4, Scalar(255,255,255));
-
-    area_img1 = videoWidth * videoHeight;
-    area_img2 = contourArea(final_points);
-    area_currOverlap = countNonZero(mask);
 
-    //it is supposed that both images have (almost) the same area, so another definition could be area_currOverlap / area_imgRef
-    area_percent = area_currOverlap / ( area_img1 + area_img2 - area_currOverlap );
+float overlapArea(const Mat &H, Size frameSize){
+    ScopedTimer timer(METRIC_OVERLAP);
+    CV_Assert(H.rows == 3 && H.cols == 3 && H.type() == CV_64F);
+    const double w = frameSize.width, h = frameSize.height;
+
+    // Clipping a quad against the 4 sides of a rectangle adds at most one vertex per side, so fixed size
+    // buffers are enough (no allocation at all in this function)
+    Point2d polyA[8], polyB[8];
+    const double corners[4][2] = {{0, 0}, {w, 0}, {w, h}, {0, h}};
+
+    // transform the corners of the frame by the given homography matrix
+    const double *m = H.ptr<double>(0);
+    for (int i = 0; i < 4; i++) {
+        double x = corners[i][0], y = corners[i][1];
+        double z = m[6] * x + m[7] * y + m[8];
+        // a corner mapped behind the camera means a degenerated homography: treat it as no overlap
+        if (z <= DBL_EPSILON) return 0.0;
+        polyA[i] = Point2d((m[0] * x + m[1] * y + m[2]) / z, (m[3] * x + m[4] * y + m[5]) / z);
+    }
+    double area_img2 = polygonArea(polyA, 4);
 
-    return area_percent;
+    // Intersection with the reference frame [0,w]x[0,h], clipping the warped quad by each side of the frame
+    int n = 4;
+    n = clipPolygon(polyA, n, polyB, 0, 0.0, true);
+    n = clipPolygon(polyB, n, polyA, 0, w, false);
+    n = clipPolygon(polyA, n, polyB, 1, 0.0, true);
+    n = clipPolygon(polyB, n, polyA, 1, h, false);
+    double area_currOverlap = (n < 3) ? 0.0 : polygonArea(polyA, n);
+
+    // Both areas are measured in the same (resized) frame coordinates the homography was estimated in
+    double area_img1 = w * h;
+    double area_union = area_img1 + area_img2 - area_currOverlap;
+    if (area_union <= 0.0) return 0.0;
+
+    //it is supposed that both images have (almost) the same area, so another definition could be area_currOverlap / area_imgRef
+    return (float) (area_currOverlap / area_union);
 }